@@ -0,0 +1,348 @@
+/*
+ * FILE:        arith.c
+ * DESCRIPTION: Implementation of segmented sieves for arithmetic functions.
+ *              The range 1..max is processed in cache-sized blocks. In each
+ *              block, each sieving prime p <= sqrt(max) walks its multiples
+ *              and then the multiples of each higher power of p, updating
+ *              phi, mu, and omega as it goes, so no division is needed in the
+ *              inner loops. Whatever a number's factored part falls short of
+ *              is either 1 or a single prime factor larger than sqrt(max).
+ *              Only phi needs that factor itself, so only phi multiplies p
+ *              into the factored part of each number. For mu and omega, each
+ *              number just adds up floor(log2 p) in a byte, which also records
+ *              the parity of the distinct primes and any square, so mu is only
+ *              written once the block is sieved. If a factor is
+ *              left over, the factored part is below sqrt(n), so twice the
+ *              sum is below log2 n. Otherwise the sum is at least
+ *              log2 n / log2 3 (floor(log2 p) / log2 p is smallest at p = 3),
+ *              so twice the sum is above log2 n. Comparing twice the sum with
+ *              floor(log2 n) thus tells the two apart for n > 1.
+ *              The values of mu are kept 2 bits per number: 00 for 0, 01 for
+ *              +1, and 11 for -1, the low 2 bits of each value in two's
+ *              complement. The sum of mu over each block is kept as well, so
+ *              that M(max) alone is just the sum of the blocks' sums.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "primes.h"
+#include "arith.h"
+#include "debug.h"
+
+#define ERR_PRIMES_ALLOCATE "sieve: sieving primes"
+#define ERR_BLOCK_ALLOCATE  "sieve: arithmetic function block"
+
+/* Number of integers sieved at a time */
+#define BLOCK_SIZE 131072UL
+
+/* Four 2-bit values of mu per byte */
+#define MU_BYTES(n) (((n) + 3) / 4)
+
+/* Index of the first multiple of m in a block starting at lo */
+#define FIRST_MULTIPLE(lo, m) ((lo) % (m) ? (m) - (lo) % (m) : 0)
+
+/* Shift of the ith 2-bit value of mu within its byte */
+#define MU_SHIFT(i) (2 * ((i) % 4))
+
+/* Get the ith value of mu as an int: the low bit less the high bit */
+#define MU_GET(mu, i) \
+    ((int) (((mu)[(i) / 4] >> MU_SHIFT(i)) & 1) \
+            - (int) (((mu)[(i) / 4] >> MU_SHIFT(i)) & 2))
+
+/* Set the ith value of mu to v (-1, 0, or 1) */
+#define MU_SET(mu, i, v) \
+    ((mu)[(i) / 4] = (unsigned char) (((mu)[(i) / 4] & ~(3 << MU_SHIFT(i))) \
+            | ((v) & 3) << MU_SHIFT(i)))
+
+/* The byte kept per integer for mu and omega: the sum of floor(log2 p) over
+ * the prime factors p found, with multiplicity (at most 63, since n < 2^64),
+ * and whether the number of distinct ones is odd and whether a square was */
+#define LOG_SUM     0x3f
+#define LOG_ODD     0x40
+#define LOG_SQUARE  0x80
+
+/* Names of the arithmetic functions, indexed by ARITH_* */
+static const char *names[] = {"phi", "mu", "omega", "mertens"};
+
+/*
+ * STRUCT:      block
+ * DESCRIPTION: The values being computed for one block of integers.
+ * FIELDS:      lo (unsigned long): The first integer in the block.
+ *              size (unsigned long): The number of integers in the block.
+ *              part (unsigned long *): The factored part of each integer, or
+ *              NULL if unused (only phi needs it).
+ *              logs (unsigned char *): The LOG_* byte of each integer, or
+ *              NULL if unused (if part is used).
+ *              phi (unsigned long *): Euler's totient, or NULL if unused.
+ *              omega (unsigned char *): The number of distinct prime factors,
+ *              or NULL if unused.
+ *              mu (unsigned char *): The Moebius function, 2 bits per
+ *              integer, or NULL if unused.
+ *              sum (long): The sum of mu over the block, if mu is used.
+ */
+struct block {
+    unsigned long lo;
+    unsigned long size;
+    unsigned long *part;
+    unsigned char *logs;
+    unsigned long *phi;
+    unsigned char *omega;
+    unsigned char *mu;
+    long sum;
+};
+
+/* Static ("private") function prototypes */
+static void sieve_block(struct block *, const unsigned long *,
+        const unsigned long);
+static unsigned char floor_log2(unsigned long);
+static int run(const unsigned long, const int, const int);
+
+/*
+ * FUNCTION:    arith_function
+ * DESCRIPTION: Look up an arithmetic function by name.
+ * PARAMETERS:  name (const char *): One of "phi", "mu", "omega", "mertens".
+ * RETURNS:     The corresponding ARITH_* constant, or -1 if there is none.
+ */
+int arith_function(const char *name) {
+    int i;
+    for (i = 0; i < (int) (sizeof(names) / sizeof(*names)); i++)
+        if (!strcmp(name, names[i]))
+            return i;
+    return -1;
+}
+
+/*
+ * FUNCTION:    arith_list
+ * DESCRIPTION: Prints an arithmetic function for every integer from 1 up to
+ *              a specified bound to stdout, one `n<TAB>value' line each.
+ * PARAMETERS:  max (const unsigned long): The upper bound.
+ *              function (const int): One of the ARITH_* constants.
+ *              last_only (const int): If nonzero, print only the value for max
+ *              itself, without the integer. For phi, mu, and omega only the
+ *              last block is then sieved.
+ * RETURNS:     Nothing.
+ */
+void arith_list(const unsigned long max, const int function,
+        const int last_only) {
+    if (run(max, function, last_only ? 0 : 1))
+        exit(EXIT_FAILURE);
+}
+
+/*
+ * FUNCTION:    run
+ * DESCRIPTION: Sieve an arithmetic function block by block up to max.
+ * PARAMETERS:  max (const unsigned long): The upper bound.
+ *              function (const int): One of the ARITH_* constants.
+ *              print_all (const int): If nonzero, print every value as
+ *              `n<TAB>value'; otherwise print only the value for max.
+ * RETURNS:     0 on success, -1 if memory allocation failed.
+ */
+static int run(const unsigned long max, const int function,
+        const int print_all) {
+    struct block block = {0, 0, NULL, NULL, NULL, NULL, NULL, 0};
+    unsigned long *primes = NULL;   /* The sieving primes */
+    unsigned long nprimes;          /* The number of sieving primes */
+    unsigned long i;                /* Index into the block */
+    long running = 0;               /* Running sum of mu */
+    long value;                     /* Value of the function */
+    int status = -1;                /* Return value */
+
+    if (max < 1) {
+        if (!print_all)
+            printf("%d\n", 0);
+        return 0;
+    }
+
+    primes = small_primes(isqrt(max), &nprimes);
+    if (!primes) {
+        perror(ERR_PRIMES_ALLOCATE);
+        goto end;
+    }
+
+    /* Allocate only the arrays the function needs */
+    if (function == ARITH_PHI) {
+        block.part = malloc(BLOCK_SIZE * sizeof(unsigned long));
+        block.phi = malloc(BLOCK_SIZE * sizeof(unsigned long));
+    } else {
+        block.logs = malloc(BLOCK_SIZE);
+    }
+    if (function == ARITH_OMEGA)
+        block.omega = malloc(BLOCK_SIZE);
+    if (function == ARITH_MU || function == ARITH_MERTENS)
+        block.mu = malloc(MU_BYTES(BLOCK_SIZE));
+    if ((function == ARITH_PHI && (!block.part || !block.phi))
+            || (function != ARITH_PHI && !block.logs)
+            || (function == ARITH_OMEGA && !block.omega)
+            || ((function == ARITH_MU || function == ARITH_MERTENS)
+                && !block.mu)) {
+        perror(ERR_BLOCK_ALLOCATE);
+        goto end;
+    }
+
+    /* Only the Mertens function and full listings need the earlier blocks */
+    block.lo = 1;
+    if (function != ARITH_MERTENS && !print_all)
+        block.lo = max;
+
+    for (;;) {
+        block.size = max - block.lo < BLOCK_SIZE ? max - block.lo + 1
+                                                 : BLOCK_SIZE;
+        sieve_block(&block, primes, nprimes);
+        if (!print_all)
+            running += block.sum;
+
+        for (i = 0; i < block.size && print_all; i++) {
+            switch (function) {
+                case ARITH_PHI:
+                    value = (long) block.phi[i];
+                    break;
+                case ARITH_MU:
+                    value = MU_GET(block.mu, i);
+                    break;
+                case ARITH_OMEGA:
+                    value = block.omega[i];
+                    break;
+                default:
+                    value = running += MU_GET(block.mu, i);
+            }
+            if (function == ARITH_PHI)
+                printf("%lu\t%lu\n", block.lo + i, block.phi[i]);
+            else
+                printf("%lu\t%ld\n", block.lo + i, value);
+        }
+
+        if (max - block.lo < BLOCK_SIZE)
+            break;
+        block.lo += BLOCK_SIZE;
+    }
+
+    i = block.size - 1;
+    if (!print_all && function == ARITH_PHI)
+        printf("%lu\n", block.phi[i]);
+    else if (!print_all)
+        printf("%ld\n", function == ARITH_MU ? (long) MU_GET(block.mu, i)
+                : function == ARITH_OMEGA ? (long) block.omega[i] : running);
+    status = 0;
+
+end:
+    free(primes);
+    free(block.part);
+    free(block.logs);
+    free(block.phi);
+    free(block.omega);
+    free(block.mu);
+    return status;
+}
+
+/*
+ * FUNCTION:    sieve_block
+ * DESCRIPTION: Compute the arithmetic functions for one block of integers.
+ * PARAMETERS:  block (struct block *): The block. Its lo and size fields say
+ *              which integers it holds, and the arrays that are not NULL are
+ *              filled in.
+ *              primes (const unsigned long *): The primes up to at least the
+ *              square root of the last integer in the block.
+ *              nprimes (const unsigned long): The number of primes.
+ * RETURNS:     Nothing.
+ */
+static void sieve_block(struct block *block, const unsigned long *primes,
+        const unsigned long nprimes) {
+    /* Local copies, which the byte stores below can't be assumed to alias */
+    const unsigned long lo = block->lo;
+    const unsigned long size = block->size;
+    const unsigned long hi = lo + (size - 1);
+    unsigned long *const part = block->part;
+    unsigned char *const logs = block->logs;
+    unsigned long *const phi = block->phi;
+    unsigned char *const omega = block->omega;
+    unsigned char *const mu = block->mu;
+    unsigned long i;        /* Index into the block */
+    unsigned long j;        /* Index into the primes */
+    unsigned long p;        /* A sieving prime */
+    unsigned long q;        /* A power of p */
+    unsigned long n;        /* The integer at index i */
+    unsigned char lg;       /* floor(log2 p), or floor(log2 n) */
+    unsigned left;          /* 1 if n has a prime factor left over */
+    int value;              /* mu(n) */
+
+    /* Nothing is factored yet */
+    if (part)
+        for (i = 0; i < size; i++)
+            part[i] = 1;
+    if (logs)
+        memset(logs, 0, size);
+    if (phi)
+        for (i = 0; i < size; i++)
+            phi[i] = 1;
+    if (omega)
+        memset(omega, 0, size);
+
+    for (j = 0; j < nprimes && primes[j] <= hi / primes[j]; j++) {
+        p = primes[j];
+        lg = floor_log2(p);
+
+        /* Multiples of p: one more distinct prime factor */
+        for (i = FIRST_MULTIPLE(lo, p); i < size; i += p) {
+            if (part)
+                part[i] *= p;
+            else
+                logs[i] = (unsigned char) ((logs[i] + lg) ^ LOG_ODD);
+            if (phi)
+                phi[i] *= p - 1;
+            if (omega)
+                omega[i]++;
+        }
+
+        /* Multiples of p^2, p^3, ...: one more factor of p each */
+        for (q = p; q <= hi / p; ) {
+            q *= p;
+            for (i = FIRST_MULTIPLE(lo, q); i < size; i += q) {
+                if (part)
+                    part[i] *= p;
+                else
+                    logs[i] = (unsigned char) ((logs[i] + lg) | LOG_SQUARE);
+                if (phi)
+                    phi[i] *= p;
+            }
+        }
+    }
+
+    /* What is left unfactored is 1 or a prime larger than sqrt(hi). Whether
+     * it is there is as good as random, so mu and omega don't branch on it. */
+    if (phi) {
+        for (i = 0; i < size; i++)
+            if (part[i] != lo + i)
+                phi[i] *= (lo + i) / part[i] - 1;
+        return;
+    }
+    block->sum = 0;
+    for (i = 0, n = lo, lg = floor_log2(n); i < size; i++, n++) {
+        lg += (unsigned char) (n >> lg > 1);
+        left = n > 1 && 2 * (logs[i] & LOG_SUM) <= lg;
+        if (omega)
+            omega[i] += (unsigned char) left;
+        if (mu) {
+            value = !(logs[i] & LOG_SQUARE)
+                * (1 - 2 * (int) (!!(logs[i] & LOG_ODD) ^ left));
+            MU_SET(mu, i, value);
+            block->sum += value;
+        }
+    }
+}
+
+/*
+ * FUNCTION:    floor_log2
+ * DESCRIPTION: Computes the base 2 logarithm of a positive integer, rounded
+ *              down.
+ * PARAMETERS:  n (unsigned long): The integer.
+ * RETURNS:     The largest k such that 2^k <= n.
+ */
+static unsigned char floor_log2(unsigned long n) {
+    unsigned char k = 0;    /* Return value */
+
+    while (n >>= 1)
+        k++;
+    return k;
+}
@@ -0,0 +1,21 @@
+/*
+ * FILE:        arith.h
+ * DESCRIPTION: Interface for sieving arithmetic functions over a range: Euler's
+ *              totient phi(n), the Moebius function mu(n), the number of
+ *              distinct prime factors omega(n), and the Mertens function M(n),
+ *              which is the running sum of mu.
+ */
+
+#ifndef ARITH_H
+#define ARITH_H
+
+/* The arithmetic functions that can be sieved */
+#define ARITH_PHI       0
+#define ARITH_MU        1
+#define ARITH_OMEGA     2
+#define ARITH_MERTENS   3
+
+int arith_function(const char *);
+void arith_list(const unsigned long, const int, const int);
+
+#endif
@@ -26,6 +26,47 @@ struct bitarray {
 /* Number of bits in an element of a bit array */
 #define NBITS (CHAR_BIT * sizeof(int))
 
+/* Number of trailing zero bits in a nonzero unsigned int */
+#ifdef __GNUC__
+#define ctz(x) ((unsigned long) __builtin_ctz(x))
+#else
+static unsigned long ctz(unsigned int x) {
+    unsigned long n = 0;
+    while (!(x & 1U)) {
+        x >>= 1;
+        n++;
+    }
+    return n;
+}
+#endif
+
+/* Bit k of a bit array is bit k % 8 of byte k / 8 of the array when ints are
+ * little-endian, which lets clear_stride work on bytes */
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__) \
+    && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ && CHAR_BIT == 8
+#define BYTE_ORDERED
+#endif
+
+/* The jth of 8 consecutive bits k, k + stride, ..., k + 7 stride, for an odd
+ * stride, when k = r (mod 8) and stride = 8 q + m: its byte is j q + OFFSET
+ * bytes past that of bit k, and MASK clears it within the byte */
+#define OFFSET(r, m, j) (((r) + (j) * (m)) / 8)
+#define MASK(r, m, j)   ((unsigned char) ~(1U << (((r) + (j) * (m)) % 8)))
+#define CLEAR(r, m, j)  byte[i + (j) * q + OFFSET(r, m, j)] &= MASK(r, m, j)
+
+/* Clear 8 bits per round, then move stride bytes (8 strides of bits) on */
+#define UNROLLED(r, m)                                                  \
+    case (m) / 2 * 8 + (r):                                             \
+        for (i = 0; i < end; i += stride) {                             \
+            CLEAR(r, m, 0); CLEAR(r, m, 1); CLEAR(r, m, 2);             \
+            CLEAR(r, m, 3); CLEAR(r, m, 4); CLEAR(r, m, 5);             \
+            CLEAR(r, m, 6); CLEAR(r, m, 7);                             \
+        }                                                               \
+        break;
+#define UNROLLED_ROW(m)                                                 \
+    UNROLLED(0, m) UNROLLED(1, m) UNROLLED(2, m) UNROLLED(3, m)          \
+    UNROLLED(4, m) UNROLLED(5, m) UNROLLED(6, m) UNROLLED(7, m)
+
 /*
  * FUNCTION:    new_bitarray
  * DESCRIPTION: Allocates memory for a new bit array holding at least the
@@ -96,7 +137,7 @@ void set_all_bits(struct bitarray *bits) {
  * RETURNS:     Nothing.
  */
 void clear_bit(struct bitarray *bits, const unsigned long k) {
-    bits->array[k / NBITS] &= ~(1 << (k % NBITS));
+    bits->array[k / NBITS] &= ~(1U << (k % NBITS));
 }
 
 /*
@@ -108,5 +149,146 @@ void clear_bit(struct bitarray *bits, const unsigned long k) {
  * RETURNS:     The kth bit in the bit array
  */
 int get_bit(struct bitarray *bits, const unsigned long k) {
-    return (bits->array[k / NBITS] & (1 << (k % NBITS))) != 0;
+    return ((unsigned int) bits->array[k / NBITS]
+            & (1U << (k % NBITS))) != 0;
+}
+
+/*
+ * FUNCTION:    next_set_bit
+ * DESCRIPTION: Find the first set bit at or after a given position. The bit
+ *              array is scanned one element at a time, and the position of
+ *              the lowest set bit in an element is found by counting its
+ *              trailing zeros.
+ * PARAMETERS:  bits (struct bitarray *): The bit array to scan.
+ *              k (const unsigned long): The position to start scanning at.
+ *              n (const unsigned long): The number of bits in use. Bits at
+ *              positions n and above are ignored.
+ * RETURNS:     The position of the first set bit in [k, n), or n if there is
+ *              no such bit.
+ */
+unsigned long next_set_bit(struct bitarray *bits, const unsigned long k,
+        const unsigned long n) {
+    unsigned long index = k / NBITS;    /* Element containing the kth bit */
+    unsigned int word;                  /* Current element of the array */
+    unsigned long pos;                  /* Position of the set bit found */
+
+    if (k >= n)
+        return n;
+
+    /* Ignore the bits before the kth bit in its element */
+    word = (unsigned int) bits->array[index] & (~0U << (k % NBITS));
+    while (!word) {
+        if (++index >= (n + NBITS - 1) / NBITS)
+            return n;
+        word = (unsigned int) bits->array[index];
+    }
+
+    pos = index * NBITS + ctz(word);
+    return pos < n ? pos : n;
 }
+
+/*
+ * FUNCTION:    clear_stride
+ * DESCRIPTION: Sets bits k, k + stride, k + 2 stride, ... below n to 0. This
+ *              is the crossing-off loop of the sieves: with one bit per odd
+ *              integer, the odd multiples of an odd prime p are p bits apart.
+ *              For an odd stride, 8 consecutive bits cover exactly stride
+ *              bytes, and their bytes and masks only depend on k % 8 and
+ *              stride % 8, so a jump table on those picks one of 32 unrolled
+ *              loops that clear 8 bits per round with constant masks and no
+ *              divisions. The last few bits are cleared one at a time.
+ * PARAMETERS:  bits (struct bitarray *): The bit array to operate on.
+ *              k (unsigned long): The position of the first bit to clear.
+ *              stride (const unsigned long): The distance between the bits.
+ *              n (const unsigned long): The number of bits in use. Bits at
+ *              positions n and above are left alone.
+ * RETURNS:     Nothing.
+ */
+void clear_stride(struct bitarray *bits, unsigned long k,
+        const unsigned long stride, const unsigned long n) {
+#ifdef BYTE_ORDERED
+    unsigned char *byte;    /* The byte holding bit k */
+    unsigned long q;        /* Whole bytes in a stride of bits */
+    unsigned long end;      /* Bytes covered by the unrolled rounds */
+    unsigned long i;        /* Offset of the current round from byte */
+
+    /* Only unroll if a round of 8 bits fits: k + 7 stride < n */
+    if (stride % 2 && k < n && (n - k - 1) / 7 >= stride) {
+        byte = (unsigned char *) bits->array + k / 8;
+        q = stride / 8;
+        end = ((n - k - 1 - 7 * stride) / stride / 8 + 1) * stride;
+        switch (stride % 8 / 2 * 8 + k % 8) {
+            UNROLLED_ROW(1)
+            UNROLLED_ROW(3)
+            UNROLLED_ROW(5)
+            UNROLLED_ROW(7)
+        }
+        k += 8 * end;
+    }
+#endif
+
+    for (; k < n; k += stride)
+        clear_bit(bits, k);
+}
+
+/* Compile with -D'TEST' to enable testing of clear_stride */
+#ifdef TEST
+
+#include <stdio.h>
+
+#define TEST_BITS       4096    /* Size of the bit arrays compared */
+#define TEST_STRIDES    64      /* Strides 1, ..., TEST_STRIDES are tried */
+#define TEST_STARTS     16      /* First bits 0, ..., TEST_STARTS - 1 */
+#define TEST_ROUNDS     20      /* n goes up to about this many strides past k */
+
+/*
+ * FUNCTION:    main
+ * DESCRIPTION: Compares clear_stride with clearing the same bits one at a time
+ *              with clear_bit, for every stride and first bit up to the limits
+ *              above (so every k % 8 and stride % 8, and thus every unrolled
+ *              loop, is covered), and for every n from 0 to about TEST_ROUNDS
+ *              strides past the first bit (so n falls on and next to every
+ *              boundary between unrolled rounds and the final single bits).
+ *              The whole arrays are compared, so a bit cleared at or past n
+ *              is caught as well.
+ * RETURNS:     EXIT_SUCCESS if every case agrees, EXIT_FAILURE otherwise.
+ */
+int main(void) {
+    struct bitarray *fast = new_bitarray(TEST_BITS);    /* clear_stride */
+    struct bitarray *slow = new_bitarray(TEST_BITS);    /* clear_bit */
+    unsigned long stride, k, n, last, i;                /* Loop indices */
+    unsigned long cases = 0, failures = 0;              /* Results */
+
+    if (!fast || !slow) {
+        perror("bitarray_test");
+        return EXIT_FAILURE;
+    }
+
+    for (stride = 1; stride <= TEST_STRIDES; stride++) {
+        for (k = 0; k < TEST_STARTS; k++) {
+            last = k + TEST_ROUNDS * stride;
+            if (last > TEST_BITS)
+                last = TEST_BITS;
+            for (n = 0; n <= last; n++) {
+                set_all_bits(fast);
+                set_all_bits(slow);
+                clear_stride(fast, k, stride, n);
+                for (i = k; i < n; i += stride)
+                    clear_bit(slow, i);
+                cases++;
+                if (memcmp(fast->array, slow->array, fast->size)) {
+                    if (failures++ < 10)
+                        fprintf(stderr, "clear_stride(k = %lu, stride = %lu, "
+                                "n = %lu) differs\n", k, stride, n);
+                }
+            }
+        }
+    }
+
+    printf("clear_stride: %lu cases, %lu failures\n", cases, failures);
+    delete_bitarray(&fast);
+    delete_bitarray(&slow);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif /* TEST */
@@ -14,5 +14,9 @@ void delete_bitarray(struct bitarray **);
 void set_all_bits(struct bitarray *);
 void clear_bit(struct bitarray *, const unsigned long);
 int get_bit(struct bitarray *, const unsigned long);
+void clear_stride(struct bitarray *, unsigned long, const unsigned long,
+        const unsigned long);
+unsigned long next_set_bit(struct bitarray *, const unsigned long,
+        const unsigned long);
 
 #endif
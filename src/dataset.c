@@ -0,0 +1,298 @@
+/*
+ * FILE:        dataset.c
+ * DESCRIPTION: Implementation of prime datasets. [0, max] is cut into
+ *              partitions [k w, (k + 1) w - 1] of width w (the last one ends
+ *              at max), and a pool of threads takes the partitions in order
+ *              from a shared counter. Each partition is sieved with its own
+ *              segmented sieve and written to its own file,
+ *              primes-<lo>-<hi>.bin, as 64-bit little-endian integers, so no
+ *              thread ever waits on another's output. Once every file is
+ *              written, the manifest lists each file with its range, its
+ *              number of primes, and the FNV-1a 64-bit hash of its bytes.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "segment.h"
+#include "dataset.h"
+#include "debug.h"
+
+/* Names of the files and layout of the manifest */
+#define FILE_FMT        "primes-%lu-%lu.bin"
+#define PATH_FMT        "%s/" FILE_FMT
+#define MANIFEST_HEADER "# file lo hi count fnv1a64\n"
+#define MANIFEST_FMT    FILE_FMT " %lu %lu %lu %016lx\n"
+
+/* Room for a file name on top of the directory name */
+#define NAME_LEN 64
+
+/* Bytes per prime in a file */
+#define PRIME_BYTES 8
+
+/* Number of primes buffered before each write */
+#define BUFFER_PRIMES 8192
+
+/* FNV-1a 64-bit parameters */
+#define FNV_OFFSET  0xcbf29ce484222325UL
+#define FNV_PRIME   0x100000001b3UL
+
+/*
+ * STRUCT:      part
+ * DESCRIPTION: One partition and what was written for it.
+ * FIELDS:      lo, hi (unsigned long): The partition (inclusive).
+ *              count (unsigned long): The number of primes in the partition.
+ *              hash (unsigned long): The FNV-1a hash of the file's bytes.
+ */
+struct part {
+    unsigned long lo, hi;
+    unsigned long count;
+    unsigned long hash;
+};
+
+/*
+ * STRUCT:      job
+ * DESCRIPTION: The state shared by the threads writing a dataset.
+ * FIELDS:      dir (const char *): The directory of the files.
+ *              parts (struct part *): The partitions, in order.
+ *              nparts (unsigned long): The number of partitions.
+ *              next (unsigned long): The next partition to take.
+ *              error (int): The errno value of the first failure, or 0.
+ *              lock (pthread_mutex_t): Guards next and error.
+ */
+struct job {
+    const char *dir;
+    struct part *parts;
+    unsigned long nparts;
+    unsigned long next;
+    int error;
+    pthread_mutex_t lock;
+};
+
+/* Static ("private") function prototypes */
+static void * worker(void *);
+static int write_part(const char *, struct part *);
+static int write_manifest(const struct job *);
+
+/*
+ * FUNCTION:    write_dataset
+ * DESCRIPTION: Writes the primes up to max to one file per partition in a
+ *              directory (created if needed), and then the manifest.
+ * ERRORS:      If the directory, a file, a thread, or memory can't be had, or
+ *              a write fails, returns -1 with errno set by the first failure.
+ *              The files already written are left in place, but the manifest
+ *              is only written if every file was.
+ * PARAMETERS:  dir (const char *): The directory to write to.
+ *              max (const unsigned long): The largest integer to sieve.
+ *              width (const unsigned long): The width of a partition.
+ *              nthreads (const unsigned long): The number of threads, or 0
+ *              for one per online processor.
+ * RETURNS:     0 on success, -1 on failure.
+ */
+int write_dataset(const char *dir, const unsigned long max,
+        const unsigned long width, const unsigned long nthreads) {
+    struct job job;                 /* The shared state */
+    pthread_t *threads = NULL;      /* The thread pool */
+    unsigned long nstarted = 0;     /* The number of threads started */
+    unsigned long n = nthreads;     /* The number of threads wanted */
+    unsigned long k;                /* Loop index */
+    long online;                    /* The number of online processors */
+    int status = -1;                /* Return value */
+
+    /* There is no partition past the last one, even with max = ULONG_MAX */
+    if (!width || !(job.nparts = max / width + 1)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (mkdir(dir, 0777) && errno != EEXIST)
+        return -1;
+
+    job.dir = dir;
+    job.next = 0;
+    job.error = 0;
+    if ((job.error = pthread_mutex_init(&job.lock, NULL))) {
+        errno = job.error;
+        return -1;
+    }
+    if (!(job.parts = calloc(job.nparts, sizeof(struct part))))
+        goto end;
+    for (k = 0; k < job.nparts; k++) {
+        job.parts[k].lo = k * width;
+        job.parts[k].hi = k == job.nparts - 1 ? max : (k + 1) * width - 1;
+    }
+
+    if (!n) {
+        online = sysconf(_SC_NPROCESSORS_ONLN);
+        n = online > 0 ? (unsigned long) online : 1;
+    }
+    if (n > job.nparts)
+        n = job.nparts;
+    if (!(threads = malloc(n * sizeof(pthread_t))))
+        goto end;
+
+    DEBUG_MSG("Writing [0, %lu] to %s: %lu partitions, %lu threads",
+            max, dir, job.nparts, n);
+
+    /* If a thread can't be started, the ones already running still finish
+     * all the partitions, but the run counts as failed */
+    for (; nstarted < n; nstarted++)
+        if ((errno = pthread_create(&threads[nstarted], NULL, &worker, &job)))
+            break;
+    if (nstarted < n) {
+        pthread_mutex_lock(&job.lock);
+        if (!job.error)
+            job.error = errno;
+        pthread_mutex_unlock(&job.lock);
+    }
+    for (k = 0; k < nstarted; k++)
+        pthread_join(threads[k], NULL);
+
+    if (!job.error && write_manifest(&job))
+        job.error = errno ? errno : EIO;
+    status = job.error ? -1 : 0;
+
+end:
+    pthread_mutex_destroy(&job.lock);
+    free(threads);
+    free(job.parts);
+    if (job.error)
+        errno = job.error;
+    return status;
+}
+
+/*
+ * FUNCTION:    worker
+ * DESCRIPTION: The body of a thread: take the next partition and write it
+ *              until there are none left, or until some thread has failed.
+ * PARAMETERS:  arg (void *): The shared job.
+ * RETURNS:     NULL.
+ */
+static void * worker(void *arg) {
+    struct job *job = arg;  /* The shared state */
+    unsigned long k;        /* The partition taken */
+
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        k = job->error ? job->nparts : job->next;
+        if (k < job->nparts)
+            job->next++;
+        pthread_mutex_unlock(&job->lock);
+        if (k >= job->nparts)
+            return NULL;
+
+        if (write_part(job->dir, &job->parts[k])) {
+            pthread_mutex_lock(&job->lock);
+            if (!job->error)
+                job->error = errno ? errno : EIO;
+            pthread_mutex_unlock(&job->lock);
+        }
+    }
+}
+
+/*
+ * FUNCTION:    write_part
+ * DESCRIPTION: Sieve one partition and write its primes to its file, filling
+ *              in the count and hash.
+ * ERRORS:      If memory allocation, opening, or writing fails, returns -1.
+ * PARAMETERS:  dir (const char *): The directory of the file.
+ *              part (struct part *): The partition.
+ * RETURNS:     0 on success, -1 on failure.
+ */
+static int write_part(const char *dir, struct part *part) {
+    unsigned char buffer[BUFFER_PRIMES * PRIME_BYTES];  /* Pending output */
+    unsigned char *byte;            /* The next byte of the buffer to fill */
+    struct segsieve *sieve = NULL;  /* The sieve over the partition */
+    FILE *file = NULL;              /* The partition's file */
+    char *path;                     /* The name of the file */
+    unsigned long p;                /* A prime in the partition */
+    unsigned long hash = FNV_OFFSET;    /* FNV-1a hash of the bytes */
+    size_t len;                     /* Bytes in the buffer */
+    int i;                          /* Byte of a prime */
+    int status = -1;                /* Return value */
+
+    if (!(path = malloc(strlen(dir) + NAME_LEN)))
+        return -1;
+    sprintf(path, PATH_FMT, dir, part->lo, part->hi);
+    if (!(sieve = new_segsieve(part->lo, part->hi))
+            || !(file = fopen(path, "wb")))
+        goto end;
+
+    part->count = 0;
+    byte = buffer;
+    while ((status = next_prime(sieve, &p)) > 0) {
+        for (i = 0; i < PRIME_BYTES; i++) {
+            *byte = (unsigned char) (p >> (8 * i));
+            hash = (hash ^ *byte++) * FNV_PRIME;
+        }
+        part->count++;
+        len = (size_t) (byte - buffer);
+        if (len == sizeof(buffer)) {
+            if (fwrite(buffer, 1, len, file) != len) {
+                status = -1;
+                goto end;
+            }
+            byte = buffer;
+        }
+    }
+    if (status < 0)
+        goto end;
+    status = -1;
+    len = (size_t) (byte - buffer);
+    if (fwrite(buffer, 1, len, file) != len)
+        goto end;
+    part->hash = hash;
+    status = 0;
+
+    DEBUG_MSG("Wrote %lu primes to %s", part->count, path);
+
+end:
+    if (file && fclose(file))
+        status = -1;
+    delete_segsieve(&sieve);
+    free(path);
+    return status;
+}
+
+/*
+ * FUNCTION:    write_manifest
+ * DESCRIPTION: Write the manifest of a finished dataset: a header line, then
+ *              one line per file, in order.
+ * ERRORS:      If memory allocation, opening, or writing fails, returns -1.
+ * PARAMETERS:  job (const struct job *): The finished job.
+ * RETURNS:     0 on success, -1 on failure.
+ */
+static int write_manifest(const struct job *job) {
+    const struct part *part;    /* A partition */
+    FILE *file;                 /* The manifest */
+    char *path;                 /* The name of the manifest */
+    unsigned long k;            /* Loop index */
+    int status = 0;             /* Return value */
+
+    if (!(path = malloc(strlen(job->dir) + NAME_LEN)))
+        return -1;
+    sprintf(path, "%s/" DATASET_MANIFEST, job->dir);
+    file = fopen(path, "w");
+    free(path);
+    if (!file)
+        return -1;
+
+    if (fputs(MANIFEST_HEADER, file) == EOF)
+        status = -1;
+    for (k = 0; k < job->nparts && !status; k++) {
+        part = &job->parts[k];
+        if (fprintf(file, MANIFEST_FMT, part->lo, part->hi, part->lo,
+                    part->hi, part->count, part->hash) < 0)
+            status = -1;
+    }
+    if (fclose(file))
+        status = -1;
+    return status;
+}
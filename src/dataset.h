@@ -0,0 +1,16 @@
+/*
+ * FILE:        dataset.h
+ * DESCRIPTION: Interface for writing the primes up to a bound as a dataset:
+ *              one binary file per fixed-width partition of [0, max], written
+ *              by several threads at once, plus a manifest indexing them.
+ */
+
+#ifndef DATASET_H
+#define DATASET_H
+
+#define DATASET_MANIFEST    "MANIFEST"  /* Name of the manifest file */
+
+int write_dataset(const char *, const unsigned long, const unsigned long,
+        const unsigned long);
+
+#endif
@@ -0,0 +1,178 @@
+/*
+ * FILE:        gaps.c
+ * DESCRIPTION: Implementation of streaming prime gap statistics: a histogram
+ *              of gap sizes with the first occurrence of each size, the list
+ *              of maximal gaps (record gaps), and statistics on the merit of
+ *              the gaps. The merit of a gap g following the prime p is
+ *              g / log(p).
+ */
+
+#include <stdlib.h>
+#include <math.h>
+
+#include "gaps.h"
+#include "debug.h"
+
+/* Number of histogram slots. Slot 0 holds the gap 1 (between 2 and 3), and
+ * slot k > 0 holds the gap 2k. All gaps between primes below 2^64 fit. */
+#define HIST_SIZE   1024
+
+/* Maximum number of record gaps kept. There are fewer than 100 maximal gaps
+ * between primes below 2^64. */
+#define MAX_RECORDS 128
+
+/*
+ * STRUCT:      gapstats
+ * DESCRIPTION: Running statistics on the gaps between consecutive primes.
+ * FIELDS:      nprimes (unsigned long): The number of primes seen so far.
+ *              start (unsigned long): The first prime seen.
+ *              last (unsigned long): The last prime seen.
+ *              count (unsigned long [HIST_SIZE]): Histogram of gap sizes.
+ *              first (unsigned long [HIST_SIZE]): The prime starting the first
+ *              occurrence of each gap size.
+ *              overflow (unsigned long): Gaps too large for the histogram.
+ *              record_gap, record_start (unsigned long [MAX_RECORDS]): The
+ *              maximal gaps and the primes starting them.
+ *              nrecords (unsigned long): The number of record gaps.
+ *              merit_sum (double): The sum of the merits of all gaps.
+ *              max_merit (double): The largest merit of any gap.
+ *              max_merit_start (unsigned long): The prime starting the gap
+ *              with the largest merit.
+ */
+struct gapstats {
+    unsigned long nprimes;
+    unsigned long start;
+    unsigned long last;
+    unsigned long count[HIST_SIZE];
+    unsigned long first[HIST_SIZE];
+    unsigned long overflow;
+    unsigned long record_gap[MAX_RECORDS];
+    unsigned long record_start[MAX_RECORDS];
+    unsigned long nrecords;
+    double merit_sum;
+    double max_merit;
+    unsigned long max_merit_start;
+};
+
+/* Histogram slot of a gap */
+#define SLOT(gap) ((gap) / 2)
+
+/* Gap size held in a histogram slot */
+#define SLOT_GAP(slot) ((slot) ? 2 * (slot) : 1)
+
+/*
+ * FUNCTION:    new_gapstats
+ * DESCRIPTION: Allocates memory for new, empty gap statistics.
+ * ERRORS:      If memory allocation fails, returns NULL.
+ * RETURNS:     A pointer to the new gap statistics.
+ */
+struct gapstats * new_gapstats(void) {
+    struct gapstats *stats = calloc(1, sizeof(struct gapstats));
+    if (!stats)
+        return NULL;
+
+    DEBUG_MSG("New gap statistics at %p", (void *) stats);
+
+    return stats;
+}
+
+/*
+ * FUNCTION:    delete_gapstats
+ * DESCRIPTION: Deallocate memory associated with gap statistics.
+ * PARAMETERS:  gpp (struct gapstats **): Pointer to a pointer to the gap
+ *              statistics to be deleted.
+ * RETURNS:     Nothing.
+ */
+void delete_gapstats(struct gapstats **gpp) {
+    if (gpp && *gpp) {
+        DEBUG_MSG("Deleting gap statistics at %p ...", (void *) *gpp);
+
+        free(*gpp);
+        *gpp = NULL;
+    }
+}
+
+/*
+ * FUNCTION:    add_prime
+ * DESCRIPTION: Update the gap statistics with the next prime. The primes must
+ *              be added in increasing order.
+ * PARAMETERS:  stats (struct gapstats *): The gap statistics to update.
+ *              p (const unsigned long): The next prime.
+ * RETURNS:     Nothing.
+ */
+void add_prime(struct gapstats *stats, const unsigned long p) {
+    unsigned long gap;      /* The gap between p and the last prime */
+    unsigned long slot;     /* The histogram slot of the gap */
+    double merit;           /* The merit of the gap */
+
+    if (stats->nprimes++ == 0) {
+        stats->start = stats->last = p;
+        return;
+    }
+
+    gap = p - stats->last;
+    slot = SLOT(gap);
+    if (slot < HIST_SIZE) {
+        if (stats->count[slot]++ == 0)
+            stats->first[slot] = stats->last;
+    } else {
+        stats->overflow++;
+    }
+
+    /* A gap is a record if it is larger than every gap before it */
+    if (!stats->nrecords || gap > stats->record_gap[stats->nrecords - 1]) {
+        if (stats->nrecords < MAX_RECORDS) {
+            stats->record_gap[stats->nrecords] = gap;
+            stats->record_start[stats->nrecords] = stats->last;
+            stats->nrecords++;
+        }
+    }
+
+    merit = (double) gap / log((double) stats->last);
+    stats->merit_sum += merit;
+    if (merit > stats->max_merit) {
+        stats->max_merit = merit;
+        stats->max_merit_start = stats->last;
+    }
+
+    stats->last = p;
+}
+
+/*
+ * FUNCTION:    print_gapstats
+ * DESCRIPTION: Print a summary of the gap statistics: the totals, the record
+ *              gaps, and the nonempty histogram slots. The record gaps are
+ *              only the maximal gaps if the primes started at 2; otherwise
+ *              they are labelled as records within the range.
+ * PARAMETERS:  stats (struct gapstats *): The gap statistics to print.
+ *              stream (FILE *): The stream to print to.
+ * RETURNS:     Nothing.
+ */
+void print_gapstats(struct gapstats *stats, FILE *stream) {
+    unsigned long ngaps = stats->nprimes ? stats->nprimes - 1 : 0;
+    unsigned long i;
+
+    fprintf(stream, "primes\t%lu\n", stats->nprimes);
+    fprintf(stream, "gaps\t%lu\n", ngaps);
+    if (!ngaps)
+        return;
+
+    fprintf(stream, "mean merit\t%.6f\n", stats->merit_sum / (double) ngaps);
+    fprintf(stream, "max merit\t%.6f\t%lu\n",
+            stats->max_merit, stats->max_merit_start);
+    if (stats->overflow)
+        fprintf(stream, "unbinned gaps\t%lu\n", stats->overflow);
+
+    fprintf(stream, "\nrecord gaps%s (gap, start, merit):\n",
+            stats->start > 2 ? " in range" : "");
+    for (i = 0; i < stats->nrecords; i++)
+        fprintf(stream, "%lu\t%lu\t%.6f\n", stats->record_gap[i],
+                stats->record_start[i], (double) stats->record_gap[i]
+                / log((double) stats->record_start[i]));
+
+    fprintf(stream, "\nhistogram (gap, count, first start):\n");
+    for (i = 0; i < HIST_SIZE; i++)
+        if (stats->count[i])
+            fprintf(stream, "%lu\t%lu\t%lu\n",
+                    SLOT_GAP(i), stats->count[i], stats->first[i]);
+}
@@ -0,0 +1,19 @@
+/*
+ * FILE:        gaps.h
+ * DESCRIPTION: Interface for accumulating prime gap statistics. The primes are
+ *              fed in increasing order one at a time, and the statistics are
+ *              kept in a fixed amount of memory regardless of how many primes
+ *              are seen.
+ */
+
+#ifndef GAPS_H
+#define GAPS_H
+
+#include <stdio.h>
+
+struct gapstats * new_gapstats(void);
+void delete_gapstats(struct gapstats **);
+void add_prime(struct gapstats *, const unsigned long);
+void print_gapstats(struct gapstats *, FILE *);
+
+#endif
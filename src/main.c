@@ -8,43 +8,145 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
+#include <limits.h>
 #include <errno.h>
+#include <signal.h>
 #include <getopt.h>
 
 #include "sieve.h"
+#include "spf.h"
+#include "arith.h"
+#include "primesum.h"
+#include "print.h"
+#include "progression.h"
+#include "segment.h"
+#include "gaps.h"
+#include "shard.h"
+#include "dataset.h"
 #include "main.h"
 
 /* Static ("private") function prototypes */
 static void process_options(int *, const char ***);
+static void factor_stdin(struct spf_table *);
+static unsigned long parse_ul(const char *);
+static void sieve_range(const char *, const char *);
+static void sieve_stream(const char *);
+static void sieve_shard(const unsigned long);
+static void sieve_dataset(const unsigned long);
+static int merge(int, const char **);
+static int mode_options(char *);
+static void require_one_mode(void);
+static void require_plain_sieve(const char *);
+static void reject_option(const char, const char *);
+static void option_error(const int, const char **);
 static void sieve_error(const char *, ...);
 static void interrupt(int);
 
 /* Store the command-line options */
 static struct {
     int count;  /* If 1, count the number of primes instead of listing them */
+    int gaps;   /* If 1, summarize the prime gaps instead of listing primes */
     int help;   /* If 1, display help message and exit */
     int input;  /* If 1, read argument from stdin */
+    int factor; /* If 1, factor the numbers read from stdin */
+    const char *table;  /* Smallest-prime-factor table file, if any */
+    int arith;  /* Arithmetic function to list (ARITH_*), or -1 for none */
+    int sum;    /* If 1, sum the primes instead of listing them */
+    unsigned long exponent; /* Sum the primes raised to this power */
+    unsigned long modulus;  /* Sum the primes modulo this, if nonzero */
+    unsigned long residue;  /* Only consider primes congruent to this... */
+    unsigned long class_modulus;    /* ...modulo this, if nonzero */
+    int has_residue;    /* If 1, a residue was given */
+    const char *shard;  /* Which shard to sieve (`i/N'), if any */
+    int unbounded;  /* If 1, list the primes with no upper bound */
+    const char *output; /* Directory to write the primes to, if any */
+    unsigned long jobs; /* Threads writing them, or 0 for one per processor */
+    unsigned long width;    /* Width of the range written to each file */
+    int dataset_op;     /* The option (-j or -w) given, or 0 for none */
 } options;
 
+/* Long command-line options */
+static const struct option long_options[] = {
+    {LONG_OP_SHARD, required_argument, NULL, OP_SHARD},
+    {NULL, 0, NULL, 0}
+};
+
 /*
  * FUNCTION:    main
  * DESCRIPTION: Driver for the sieve program.
  */
 int main(int argc, const char **argv) {
     unsigned long num;          /* Sieve upper bound */
-    char *endptr;               /* For stroul's error checking */
     char *nlpos;                /* Position of first newline in the argument */
     char str[BUFSIZ];           /* String to be used as the program argument */
+    struct spf_table *table;    /* Smallest-prime-factor table */
 
     /* Set up interrupt handling */
     signal(SIGINT, &interrupt);
 
+    /* The merge subcommand has no options of its own */
+    if (argc > 1 && !strcmp(argv[1], MERGE_COMMAND))
+        return merge(argc - 2, argv + 2);
+
     /* Process the command-line options */
     process_options(&argc, &argv);
 
     /* Print help message and exit if necessary */
     if (options.help) {
-        printf(HELP_MESSAGE, OP_COUNT, OP_STDIN);
+        printf(HELP_MESSAGE, OP_UNBOUNDED, OP_OUTPUT, OP_JOBS, OP_WIDTH,
+                OP_COUNT, OP_GAPS, OP_COUNT, OP_GAPS, OP_STDIN, OP_FACTOR,
+                OP_TABLE, OP_FACTOR, OP_ARITH, OP_COUNT, OP_SUM, OP_EXPONENT,
+                OP_MODULUS, OP_MODULUS, OP_RESIDUE, OP_CLASS, OP_CLASS,
+                OP_TABLE, OP_FACTOR, OP_TABLE, OP_COUNT, OP_UNBOUNDED,
+                OP_OUTPUT, OP_WIDTH, OP_JOBS, DATASET_MANIFEST);
+        return EXIT_SUCCESS;
+    }
+
+    /* The numbers to factor are read from stdin, so the upper bound can't be */
+    if (options.factor && options.input)
+        sieve_error(ERR_CONFLICT, OP_FACTOR, OP_STDIN);
+
+    /* Powers other than the first are only summed modulo something */
+    if (options.exponent != 1 && !options.modulus)
+        sieve_error(ERR_REQUIRES_OPTION, OP_EXPONENT, OP_MODULUS);
+    if (options.exponent > PRIMESUM_MAX_EXP)
+        sieve_error(ERR_EXPONENT_LARGE, PRIMESUM_MAX_EXP);
+
+    /* A residue and its modulus only make sense together */
+    if (options.has_residue && !options.class_modulus)
+        sieve_error(ERR_REQUIRES_OPTION, OP_RESIDUE, OP_CLASS);
+    if (options.class_modulus && !options.has_residue)
+        sieve_error(ERR_REQUIRES_OPTION, OP_CLASS, OP_RESIDUE);
+
+    /* Threads and partition widths only apply to output files */
+    if (options.dataset_op && !options.output)
+        sieve_error(ERR_REQUIRES_OPTION, options.dataset_op, OP_OUTPUT);
+
+    /* Only one thing can be computed at a time */
+    require_one_mode();
+
+    /* Factor using a saved table, which needs no upper bound */
+    if (options.factor && options.table) {
+        if (argc)
+            sieve_error(ERR_TOO_MANY_ARGS);
+        if (!(table = map_spf_table(options.table)))
+            sieve_error(ERR_FILE, options.table, strerror(errno));
+        factor_stdin(table);
+        delete_spf_table(&table);
+        return EXIT_SUCCESS;
+    }
+
+    /* List the primes from an optional start with no upper bound */
+    if (options.unbounded) {
+        if (argc > NUM_ARGS || options.input)
+            sieve_error(ERR_TOO_MANY_ARGS);
+        sieve_stream(argc ? argv[0] : "0");
+        return EXIT_SUCCESS;
+    }
+
+    /* Two command-line arguments are the ends of a range */
+    if (argc == NUM_ARGS + 1 && !options.input) {
+        sieve_range(argv[0], argv[1]);
         return EXIT_SUCCESS;
     }
 
@@ -66,34 +168,59 @@ int main(int argc, const char **argv) {
         }
     } else {
         /* Otherwise, there is one command-line argument left--copy it to str */
-        (void) strncpy(str, *argv, BUFSIZ);
-        if (str[BUFSIZ - 1] != '\0')
-            /* The argument string was not null-terminated because it is too
-             * long. Print error and exit */
+        if (strlen(*argv) >= BUFSIZ)
+            /* The argument string would not fit in str with its terminating
+             * null character because it is too long. Print error and exit */
             sieve_error(ERR_TOO_LONG);
+        (void) strcpy(str, *argv);
     }
 
     /* Strip potential trailing newline */
     if ((nlpos = strchr(str, '\n')))
         *nlpos = '\0';
 
-    /* Look for a minus sign in the argument (this isn't done by strtoul) */
-    if (strchr(str, MINUS))
-        sieve_error(ERR_CONVERT, str);
-
-    /* Convert the command-line number to an unsigned long */
-    num = strtoul(str, &endptr, BASE);
-
-    /* Check if the argument was successfully converted */
-    if (endptr == str || *endptr)
-        sieve_error(ERR_CONVERT, str);
-    else if (errno == ERANGE)
-        sieve_error(ERR_TOO_LARGE, str);
+    /* Convert the argument to an unsigned long */
+    num = parse_ul(str);
 
     /*
      * Perform the sieving
      */
-    if (options.count) {
+    if (options.output) {
+        /* Write the primes up to num to files in parallel */
+        sieve_dataset(num);
+    } else if (options.shard) {
+        /* Sieve one shard of [0, num] and print its partial result */
+        sieve_shard(num);
+    } else if (options.class_modulus) {
+        /* Only sieve the primes congruent to the residue */
+        if (options.count)
+            printf(COUNT_FMT, progression_count(num, options.residue,
+                        options.class_modulus));
+        else
+            progression_list(num, options.residue, options.class_modulus);
+    } else if (options.sum || options.modulus || options.exponent != 1) {
+        /* Print the sum of the primes (or of their powers) up to num */
+        if (options.modulus)
+            printf(COUNT_FMT, prime_power_sum(num,
+                        (unsigned) options.exponent, options.modulus));
+        else
+            printu128(prime_sum(num));
+    } else if (options.arith >= 0) {
+        /* Print an arithmetic function up to num (or only at num) */
+        arith_list(num, options.arith, options.count);
+    } else if (options.factor || options.table) {
+        /* Build a smallest-prime-factor table up to num */
+        if (!(table = new_spf_table(num)))
+            sieve_error(ERR_SPF_TABLE, str, strerror(errno));
+        if (options.factor)
+            factor_stdin(table);
+        else if (save_spf_table(table, options.table))
+            sieve_error(ERR_FILE, options.table, strerror(errno));
+        delete_spf_table(&table);
+    } else if (options.gaps) {
+        /* Print statistics on the gaps between the primes up to num */
+        sieve_gaps(num);
+    } else if (options.count) {
         /* Print only the number of primes up to num */
         printf(COUNT_FMT, sieve_count(num));
     } else {
@@ -118,11 +245,28 @@ static void process_options(int *argcp, const char ***argvp) {
 
     /* Set default command-line option values */
     options.count = 0;
+    options.gaps = 0;
     options.help = 0;
     options.input = 0;
+    options.factor = 0;
+    options.table = NULL;
+    options.arith = -1;
+    options.sum = 0;
+    options.exponent = 1;
+    options.modulus = 0;
+    options.residue = 0;
+    options.class_modulus = 0;
+    options.has_residue = 0;
+    options.shard = NULL;
+    options.unbounded = 0;
+    options.output = NULL;
+    options.jobs = 0;
+    options.width = DEFAULT_WIDTH;
+    options.dataset_op = 0;
 
     /* Iterate over all options found by getopt */
-    while ((c = getopt(*argcp, (char * const *) *argvp, ALL_OPS)) != -1) {
+    while ((c = getopt_long(*argcp, (char * const *) *argvp, ALL_OPS,
+                    long_options, NULL)) != -1) {
         /* Process the option character */
         switch (c) {
             case OP_HELP:
@@ -131,11 +275,60 @@ static void process_options(int *argcp, const char ***argvp) {
             case OP_COUNT:
                 options.count = 1;
                 break;
+            case OP_GAPS:
+                options.gaps = 1;
+                break;
             case OP_STDIN:
                 options.input = 1;
                 break;
+            case OP_FACTOR:
+                options.factor = 1;
+                break;
+            case OP_TABLE:
+                options.table = optarg;
+                break;
+            case OP_ARITH:
+                if ((options.arith = arith_function(optarg)) < 0)
+                    sieve_error(ERR_ARITH_FUNCTION, optarg);
+                break;
+            case OP_SUM:
+                options.sum = 1;
+                break;
+            case OP_EXPONENT:
+                options.exponent = parse_ul(optarg);
+                break;
+            case OP_MODULUS:
+                if (!(options.modulus = parse_ul(optarg)))
+                    sieve_error(ERR_MODULUS);
+                break;
+            case OP_RESIDUE:
+                options.residue = parse_ul(optarg);
+                options.has_residue = 1;
+                break;
+            case OP_CLASS:
+                if (!(options.class_modulus = parse_ul(optarg)))
+                    sieve_error(ERR_MODULUS);
+                break;
+            case OP_SHARD:
+                options.shard = optarg;
+                break;
+            case OP_UNBOUNDED:
+                options.unbounded = 1;
+                break;
+            case OP_OUTPUT:
+                options.output = optarg;
+                break;
+            case OP_JOBS:
+                options.jobs = parse_ul(optarg);
+                options.dataset_op = c;
+                break;
+            case OP_WIDTH:
+                if (!(options.width = parse_ul(optarg)))
+                    sieve_error(ERR_WIDTH);
+                options.dataset_op = c;
+                break;
             default:
-                sieve_error(ERR_ILLEGAL_OPTION, optopt);
+                option_error(c, *argvp);
         }
     }
 
@@ -144,6 +337,341 @@ static void process_options(int *argcp, const char ***argvp) {
 }
 
 
+/*
+ * FUNCTION:    factor_stdin
+ * DESCRIPTION: Read nonnegative integers from stdin, one per line, and print
+ *              each one followed by its prime factors.
+ * PARAMETERS:  table (struct spf_table *): The table used for factoring.
+ */
+static void factor_stdin(struct spf_table *table) {
+    unsigned long factors[SPF_MAX_FACTORS];    /* Prime factors of num */
+    unsigned long num;                          /* Number to factor */
+    char str[BUFSIZ];                           /* Line read from stdin */
+    char *nlpos;                                /* Position of the newline */
+    int count;                                  /* Number of prime factors */
+    int i;                                      /* Loop index */
+
+    while (fgets(str, BUFSIZ, stdin)) {
+        if ((nlpos = strchr(str, '\n')))
+            *nlpos = '\0';
+        num = parse_ul(str);
+        if (num == 0 || num > spf_limit(table))
+            sieve_error(ERR_FACTOR_RANGE, str, spf_limit(table));
+        if ((count = spf_factor(table, num, factors)) < 0)
+            sieve_error(ERR_SPF_CORRUPT, str);
+        printf("%lu:", num);
+        for (i = 0; i < count; i++)
+            printf(" %lu", factors[i]);
+        putchar('\n');
+    }
+}
+
+
+/*
+ * FUNCTION:    sieve_range
+ * DESCRIPTION: List, count (-n), or summarize the gaps between (-g) the primes
+ *              in a range with a segmented sieve.
+ * PARAMETERS:  lo_str (const char *): The start of the range.
+ *              hi_str (const char *): The end of the range (inclusive).
+ */
+static void sieve_range(const char *lo_str, const char *hi_str) {
+    struct segsieve *sieve;         /* The segmented sieve */
+    struct gapstats *stats = NULL;  /* Statistics on the prime gaps */
+    unsigned long count = 0;        /* The number of primes */
+    unsigned long p;                /* A prime in the range */
+    int status;                     /* Result of looking for the next prime */
+
+    require_plain_sieve(RANGE_MODE);
+    if (options.output)
+        reject_option(OP_OUTPUT, RANGE_MODE);
+    if (options.shard)
+        sieve_error(ERR_RANGE_OPTION, "-", LONG_OP_SHARD, RANGE_MODE);
+
+    sieve = new_segsieve(parse_ul(lo_str), parse_ul(hi_str));
+    if (!sieve)
+        sieve_error(ERR_RANGE, lo_str, hi_str, strerror(errno));
+    if (options.gaps && !(stats = new_gapstats()))
+        sieve_error(ERR_RANGE, lo_str, hi_str, strerror(errno));
+
+    while ((status = next_prime(sieve, &p)) > 0) {
+        if (stats)
+            add_prime(stats, p);
+        else if (options.count)
+            count++;
+        else
+            printul(p);
+    }
+    if (status < 0)
+        sieve_error(ERR_RANGE, lo_str, hi_str, strerror(errno));
+
+    if (stats)
+        print_gapstats(stats, stdout);
+    else if (options.count)
+        printf(COUNT_FMT, count);
+
+    delete_gapstats(&stats);
+    delete_segsieve(&sieve);
+}
+
+
+/*
+ * FUNCTION:    sieve_stream
+ * DESCRIPTION: List the primes from a start on without an upper bound (other
+ *              than 2^64 - 1). The sieving primes and the blocks grow as the
+ *              stream goes, so the first primes are printed right away and
+ *              the stream can be cut off at any point, e.g. by `head'.
+ * PARAMETERS:  lo_str (const char *): The start of the stream.
+ */
+static void sieve_stream(const char *lo_str) {
+    struct segsieve *sieve; /* The segmented sieve */
+    unsigned long p;        /* A prime in the stream */
+    int status;             /* Result of looking for the next prime */
+
+    require_plain_sieve(UNBOUNDED_MODE);
+    if (options.output)
+        reject_option(OP_OUTPUT, UNBOUNDED_MODE);
+    if (options.shard)
+        sieve_error(ERR_RANGE_OPTION, "-", LONG_OP_SHARD, UNBOUNDED_MODE);
+    if (options.count || options.gaps)
+        reject_option(options.count ? OP_COUNT : OP_GAPS, UNBOUNDED_MODE);
+
+    if (!(sieve = new_segsieve(parse_ul(lo_str), ULONG_MAX)))
+        sieve_error(ERR_STREAM, lo_str, strerror(errno));
+
+    while ((status = next_prime(sieve, &p)) > 0)
+        printul(p);
+    if (status < 0)
+        sieve_error(ERR_STREAM, lo_str, strerror(errno));
+
+    delete_segsieve(&sieve);
+}
+
+
+/*
+ * FUNCTION:    sieve_shard
+ * DESCRIPTION: Sieve the shard of [0, max] given by the --shard option and
+ *              print its partial result record to stdout.
+ * PARAMETERS:  max (const unsigned long): The end of the whole range.
+ */
+static void sieve_shard(const unsigned long max) {
+    char str[BUFSIZ];       /* Copy of the `i/N' argument */
+    char *slash;            /* Position of the slash in str */
+    unsigned long index;    /* Which shard */
+    unsigned long nshards;  /* The number of shards */
+    struct shard shard;     /* The partial result */
+
+    require_plain_sieve("--" LONG_OP_SHARD);
+    if (options.count || options.gaps)
+        reject_option(options.count ? OP_COUNT : OP_GAPS, "--" LONG_OP_SHARD);
+
+    if (strlen(options.shard) >= BUFSIZ)
+        sieve_error(ERR_TOO_LONG);
+    (void) strcpy(str, options.shard);
+    if (!(slash = strchr(str, '/')))
+        sieve_error(ERR_SHARD, options.shard);
+    *slash = '\0';
+    index = parse_ul(str);
+    nshards = parse_ul(slash + 1);
+    if (!nshards || index >= nshards || nshards - 1 > max)
+        sieve_error(ERR_SHARD, options.shard);
+
+    if (run_shard(&shard, max, index, nshards))
+        sieve_error(ERR_SHARD_RUN, options.shard, strerror(errno));
+    print_shard(&shard, stdout);
+}
+
+
+/*
+ * FUNCTION:    sieve_dataset
+ * DESCRIPTION: Write the primes up to max to one file per partition in the
+ *              directory given by the -o option, using -j threads, and index
+ *              the files in a manifest.
+ * PARAMETERS:  max (const unsigned long): The largest integer to sieve.
+ */
+static void sieve_dataset(const unsigned long max) {
+    require_plain_sieve(OUTPUT_MODE);
+    if (options.shard)
+        sieve_error(ERR_RANGE_OPTION, "-", LONG_OP_SHARD, OUTPUT_MODE);
+    if (options.count || options.gaps)
+        reject_option(options.count ? OP_COUNT : OP_GAPS, OUTPUT_MODE);
+
+    if (write_dataset(options.output, max, options.width, options.jobs))
+        sieve_error(ERR_FILE, options.output, strerror(errno));
+}
+
+
+/*
+ * FUNCTION:    merge
+ * DESCRIPTION: The merge subcommand: read shard records from the files given
+ *              (or from stdin if there are none), and print the record that
+ *              combines them.
+ * PARAMETERS:  argc (int): The number of files.
+ *              argv (const char **): The files.
+ * RETURNS:     The exit status of the program.
+ */
+static int merge(int argc, const char **argv) {
+    struct shard *shards = NULL;    /* The records read */
+    struct shard *more;             /* The reallocated records */
+    struct shard merged;            /* The combined record */
+    unsigned long n = 0;            /* The number of records read */
+    unsigned long cap = 0;          /* The capacity of shards */
+    FILE *file;                     /* The file being read */
+    const char *name;               /* Its name */
+    int i = 0;                      /* Index of the file */
+    int status;                     /* Result of reading a record */
+
+    do {
+        name = argc ? argv[i] : STDIN_NAME;
+        if (!(file = argc ? fopen(name, "r") : stdin))
+            sieve_error(ERR_FILE, name, strerror(errno));
+        for (;;) {
+            if (n == cap) {
+                cap = cap ? 2 * cap : 64;
+                if (!(more = realloc(shards, cap * sizeof(struct shard))))
+                    sieve_error(ERR_FILE, name, strerror(errno));
+                shards = more;
+            }
+            if ((status = read_shard(&shards[n], file)) <= 0)
+                break;
+            n++;
+        }
+        if (status < 0)
+            sieve_error(ERR_SHARD_RECORD, name);
+        if (argc)
+            fclose(file);
+    } while (++i < argc);
+
+    if (merge_shards(shards, n, &merged))
+        sieve_error(ERR_SHARD_MERGE);
+    print_shard(&merged, stdout);
+
+    free(shards);
+    return EXIT_SUCCESS;
+}
+
+
+/*
+ * FUNCTION:    mode_options
+ * DESCRIPTION: Find the options given that select something other than the
+ *              plain prime sieve: -A, the prime sums (-s, -M, -e), -f or -t,
+ *              and -q.
+ * PARAMETERS:  ops (char *): Set to the options found, one per mode (at least
+ *              MAX_MODES characters).
+ * RETURNS:     The number of options found.
+ */
+static int mode_options(char *ops) {
+    int n = 0;  /* The number of options found */
+
+    if (options.arith >= 0)
+        ops[n++] = OP_ARITH;
+    if (options.sum || options.modulus || options.exponent != 1)
+        ops[n++] = options.sum ? OP_SUM : OP_MODULUS;
+    if (options.factor || options.table)
+        ops[n++] = options.factor ? OP_FACTOR : OP_TABLE;
+    if (options.class_modulus)
+        ops[n++] = OP_CLASS;
+    return n;
+}
+
+
+/*
+ * FUNCTION:    require_one_mode
+ * DESCRIPTION: Print an error and exit if options selecting different things
+ *              to compute were given together (e.g. -A and -g), or if -n was
+ *              given with one that doesn't count (only -A and -q do).
+ */
+static void require_one_mode(void) {
+    char ops[MAX_MODES + 1];    /* The mode options given */
+    int n = mode_options(ops);  /* The number of them */
+
+    if (options.gaps)
+        ops[n++] = OP_GAPS;
+    if (n > 1)
+        sieve_error(ERR_CONFLICT, ops[0], ops[1]);
+    if (n && options.count && ops[0] != OP_ARITH && ops[0] != OP_CLASS)
+        sieve_error(ERR_CONFLICT, ops[0], OP_COUNT);
+}
+
+
+/*
+ * FUNCTION:    require_plain_sieve
+ * DESCRIPTION: Print an error and exit if an option that doesn't apply to the
+ *              plain prime sieve was given.
+ * PARAMETERS:  mode (const char *): What the options can't be used with.
+ */
+static void require_plain_sieve(const char *mode) {
+    char ops[MAX_MODES];    /* The offending options */
+
+    if (mode_options(ops))
+        reject_option(ops[0], mode);
+}
+
+
+/*
+ * FUNCTION:    reject_option
+ * DESCRIPTION: Print an error that an option can't be used in a mode, and
+ *              exit.
+ * PARAMETERS:  c (const char): The option.
+ *              mode (const char *): What it can't be used with.
+ */
+static void reject_option(const char c, const char *mode) {
+    char op[2] = {0, 0};    /* The option as a string */
+
+    op[0] = c;
+    sieve_error(ERR_RANGE_OPTION, "", op, mode);
+}
+
+/*
+ * FUNCTION:    option_error
+ * DESCRIPTION: Print an error about the option getopt_long just failed on,
+ *              and exit. A short option is named by its character. A long
+ *              one has no character of its own (optopt is 0 if it is unknown,
+ *              and its value if its argument is missing), so it is named as
+ *              it was given, in the argument getopt_long just moved past.
+ * PARAMETERS:  c (const int): What getopt_long returned: ':' for a missing
+ *              argument, or '?' for an illegal option.
+ *              argv (const char **): The command-line arguments.
+ */
+static void option_error(const int c, const char **argv) {
+    char op[3] = {'-', 0, 0};   /* A short option as a string */
+    const char *name = op;      /* The option as given */
+
+    if (!optopt || (c == ':' && !strchr(ALL_OPS, optopt)))
+        name = argv[optind - 1];
+    else
+        op[1] = (char) optopt;
+    sieve_error(c == ':' ? ERR_MISSING_ARG : ERR_ILLEGAL_OPTION, name);
+}
+
+
+/*
+ * FUNCTION:    parse_ul
+ * DESCRIPTION: Convert a string to an unsigned long, printing an error and
+ *              exiting if it is not a nonnegative integer that fits.
+ * PARAMETERS:  str (const char *): The string to convert.
+ * RETURNS:     The converted number.
+ */
+static unsigned long parse_ul(const char *str) {
+    unsigned long num;  /* The converted number */
+    char *endptr;       /* For stroul's error checking */
+
+    /* Look for a minus sign in the argument (this isn't done by strtoul) */
+    if (strchr(str, MINUS))
+        sieve_error(ERR_CONVERT, str);
+
+    errno = 0;
+    num = strtoul(str, &endptr, BASE);
+
+    /* Check if the argument was successfully converted */
+    if (endptr == str || *endptr)
+        sieve_error(ERR_CONVERT, str);
+    else if (errno == ERANGE)
+        sieve_error(ERR_TOO_LARGE, str);
+
+    return num;
+}
+
+
 /*
  * FUNCTION:    sieve_error
  * DESCRIPTION: Print a specialized error message followed by a generic help
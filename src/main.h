@@ -9,7 +9,8 @@
 
 #define PROGRAM_NAME        "sieve"
 
-#define ERR_ILLEGAL_OPTION  "illegal option `-%c'.\n"
+#define ERR_ILLEGAL_OPTION  "illegal option `%s'.\n"
+#define ERR_MISSING_ARG     "option `%s' requires an argument.\n"
 #define ERR_EXPECTED_ARG    "expected argument.\n"
 #define ERR_TOO_MANY_ARGS   "too many arguments.\n"
 #define ERR_CONVERT         "`%s' is not a nonnegative integer.\n"
@@ -17,24 +18,107 @@
 #define ERR_READ_STDIN      "could not read from stdin.\n"
 #define ERR_TOO_LONG        "argument too long.\n"
 #define ERR_INTERRUPT       "interrupted.\n"
+#define ERR_CONFLICT        "options `-%c' and `-%c' cannot be used together.\n"
+#define ERR_FACTOR_RANGE    "cannot factor `%s' (must be between 1 and %lu).\n"
+#define ERR_SPF_CORRUPT     "cannot factor `%s': the factor table is corrupt.\n"
+#define ERR_SPF_TABLE       "cannot build a factor table up to %s: %s.\n"
+#define ERR_FILE            "%s: %s.\n"
+#define ERR_ARITH_FUNCTION  "unknown function `%s' (expected phi, mu, omega, \
+or mertens).\n"
+#define ERR_REQUIRES_OPTION "option `-%c' requires option `-%c'.\n"
+#define ERR_EXPONENT_LARGE  "the exponent can be at most %d.\n"
+#define ERR_MODULUS         "the modulus must be positive.\n"
+#define ERR_RANGE_OPTION    "option `-%s%s' cannot be used with %s.\n"
+#define ERR_SHARD           "`%s' is not a shard i/N with i < N <= the \
+nonnegative integer + 1.\n"
+#define ERR_SHARD_RUN       "cannot sieve shard %s: %s.\n"
+#define ERR_SHARD_RECORD    "%s: not a shard record.\n"
+#define ERR_SHARD_MERGE     "the records are not the shards 0/N, ..., N-1/N \
+of one run.\n"
+#define ERR_RANGE           "cannot sieve from %s to %s: %s.\n"
+#define ERR_WIDTH           "the width must be positive.\n"
+#define ERR_STREAM          "cannot sieve from %s on: %s.\n"
 #define ERR_USAGE_HELP      "For help, run `" PROGRAM_NAME " -%c'.\n"
 
 #define HELP_MESSAGE        "\
 Wheel-based Sieve of Eratosthenes\n\n\
 Usage:\n\
-\t" PROGRAM_NAME " [options] <nonnegative integer>\n\n\
+\t" PROGRAM_NAME " [options] <nonnegative integer>\n\
+\t" PROGRAM_NAME " -%c [<lo>]\n\
+\t" PROGRAM_NAME " -%c DIR [-%c THREADS] [-%c WIDTH] <nonnegative integer>\n\
+\t" PROGRAM_NAME " [-%c | -%c] <lo> <hi>\n\
+\t" PROGRAM_NAME " --" LONG_OP_SHARD " i/N <nonnegative integer>\n\
+\t" PROGRAM_NAME " " MERGE_COMMAND " [record files]\n\n\
 Without any options, this will list all the prime numbers less than or equal\n\
-to the specified nonnegative integer.\n\n\
+to the specified nonnegative integer, or between lo and hi inclusive. Ranges\n\
+are sieved in blocks and may end anywhere up to 2^64 - 1.\n\n\
 Options:\n\
 \t-%c\tShow only the number of primes.\n\
+\t-%c\tShow statistics on the gaps between consecutive primes: a\n\
+\t\thistogram of gap sizes, the record gaps, and their merits.\n\
 \t-%c\tRead the nonnegative integer from stdin instead of from the\n\
-\t\tcommand-line.\n"
+\t\tcommand-line.\n\
+\t-%c\tFactor the positive integers read from stdin (one per line) using\n\
+\t\ta smallest-prime-factor table up to the nonnegative integer.\n\
+\t-%c FILE\tWrite the smallest-prime-factor table up to the nonnegative\n\
+\t\tinteger to FILE. With -%c, memory-map the table in FILE instead\n\
+\t\tof building one, and take no nonnegative integer.\n\
+\t-%c FUNC\tList FUNC(k) for 1 <= k <= the nonnegative integer, where FUNC\n\
+\t\tis phi (Euler's totient), mu (Moebius), omega (number of distinct\n\
+\t\tprime factors), or mertens (running sum of mu). With -%c, show\n\
+\t\tonly the value at the nonnegative integer.\n\
+\t-%c\tShow only the sum of the primes.\n\
+\t-%c K\tSum the Kth powers of the primes instead (requires -%c).\n\
+\t-%c M\tShow the sum modulo M.\n\
+\t-%c A\tOnly consider the primes congruent to A modulo Q (requires -%c).\n\
+\t-%c Q\tThe modulus for -a. Only the numbers congruent to A are sieved.\n\n\
+To factor with a shared table, run `" PROGRAM_NAME " -%c FILE <N>' once and\n\
+then `" PROGRAM_NAME " -%c -%c FILE' in each process.\n\n\
+To split a job, run `" PROGRAM_NAME " --" LONG_OP_SHARD " i/N <max>' for\n\
+i = 0, ..., N - 1 (anywhere), each writing a one-line partial result\n\
+record. Then `" PROGRAM_NAME " " MERGE_COMMAND "' combines the records, given\n\
+as files or on stdin, into the record of a single run: the range, the\n\
+number of primes (count), the first and last primes, the number of twin\n\
+primes, the largest gap, and checksums (the sum of the primes modulo 2^64\n\
+and a hash). Use -%c for just the number of primes in a single run.\n\n\
+With -%c, list the primes from lo (or 0) on with no upper bound, printing\n\
+the first ones right away and using memory only as the stream grows.\n\n\
+With -%c, write the primes up to the nonnegative integer to DIR instead,\n\
+one file primes-<lo>-<hi>.bin (64-bit little-endian integers) for each\n\
+WIDTH integers (-%c, default 10^9), sieved and written by THREADS threads\n\
+at once (-%c, default one per processor). DIR/%s lists each file's\n\
+range, number of primes, and FNV-1a 64-bit hash.\n"
 
 #define OP_HELP     'h'     /* Option to print help message */
 #define OP_COUNT    'n'     /* Option to print the number of primes */
+#define OP_GAPS     'g'     /* Option to print prime gap statistics */
 #define OP_STDIN    'i'     /* Option to read argument from stdin */
-#define ALL_OPS     "hni"   /* All options of the program */
+#define OP_FACTOR   'f'     /* Option to factor numbers read from stdin */
+#define OP_TABLE    't'     /* Option to write or map a factor table */
+#define OP_ARITH    'A'     /* Option to list an arithmetic function */
+#define OP_SUM      's'     /* Option to print the sum of the primes */
+#define OP_EXPONENT 'e'     /* Option to sum powers of the primes */
+#define OP_MODULUS  'M'     /* Option to sum the primes modulo a number */
+#define OP_RESIDUE  'a'     /* Option to sieve one residue class */
+#define OP_CLASS    'q'     /* Option giving the modulus of the class */
+#define OP_SHARD    'S'     /* Option to sieve one shard (long only) */
+#define OP_UNBOUNDED 'u'    /* Option to list primes with no upper bound */
+#define OP_OUTPUT   'o'     /* Option to write the primes to files */
+#define OP_JOBS     'j'     /* Option giving the number of writing threads */
+#define OP_WIDTH    'w'     /* Option giving the range of each file */
+/* All options of the program; the leading ':' makes getopt return ':' for a
+ * missing argument, rather than '?' as for an illegal option */
+#define ALL_OPS     ":hngiuft:A:se:M:a:q:o:j:w:"
 
+#define LONG_OP_SHARD   "shard"     /* Long name of OP_SHARD */
+#define MERGE_COMMAND   "merge"     /* Subcommand to merge shard records */
+#define RANGE_MODE      "a range"   /* What a range is called in errors */
+#define UNBOUNDED_MODE  "-u"        /* What -u is called in errors */
+#define OUTPUT_MODE     "-o"        /* What -o is called in errors */
+#define DEFAULT_WIDTH   1000000000UL    /* Default range of each file */
+#define STDIN_NAME      "stdin"     /* What stdin is called in errors */
+
+#define MAX_MODES   4       /* Options selecting other things than primes */
 #define NUM_ARGS    1       /* Expected number of command-line arguments */
 #define BASE        0       /* For stroul - accept decimal, octal, and hex */
 #define COUNT_FMT   "%lu\n" /* Format of count output */
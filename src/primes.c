@@ -0,0 +1,106 @@
+/*
+ * FILE:        primes.c
+ * DESCRIPTION: Implementation of tables of small primes.
+ */
+
+#include <stdlib.h>
+#include <limits.h>
+#include <math.h>
+
+#include "bitarray.h"
+#include "primes.h"
+#include "debug.h"
+
+/* pi(x) < 1.25506 x / ln x for x > 1 (Rosser and Schoenfeld, 1962); the
+ * constant is rounded up to absorb the rounding of log */
+#define PI_BOUND 1.26
+
+/*
+ * FUNCTION:    small_primes
+ * DESCRIPTION: Creates an array of all the primes less than or equal to a
+ *              specified bound, in increasing order, using a plain sieve of
+ *              Eratosthenes over the odd integers. The array is dynamically
+ *              allocated and must be deallocated with free.
+ * ERRORS:      If memory allocation fails, returns NULL.
+ * PARAMETERS:  limit (const unsigned long): The largest number to consider.
+ *              This is meant to be small (e.g., the square root of a sieve's
+ *              upper bound).
+ *              count (unsigned long *): Set to the number of primes found.
+ * RETURNS:     A pointer to the array of primes.
+ */
+unsigned long * small_primes(const unsigned long limit, unsigned long *count) {
+    struct bitarray *is_prime;  /* Primality of the odd integers */
+    unsigned long *primes;      /* The primes found */
+    unsigned long nbits;        /* Number of odd integers <= limit */
+    unsigned long max;          /* Upper bound on the number of primes */
+    unsigned long n;            /* Prime candidate */
+    unsigned long k;            /* Bit index */
+
+    *count = 0;
+    nbits = limit / 2 + (limit & 1);
+
+    /* An upper bound on the number of primes, far smaller than nbits for a
+     * large limit (2^32 would otherwise take 17 GB) */
+    max = limit < 2 ? 1 : (unsigned long) (PI_BOUND * (double) limit
+            / log((double) limit)) + 1;
+    primes = malloc(max * sizeof(unsigned long));
+    if (!primes)
+        return NULL;
+
+    is_prime = new_bitarray(nbits + 1);
+    if (!is_prime) {
+        free(primes);
+        return NULL;
+    }
+    set_all_bits(is_prime);
+
+    if (limit >= 2)
+        primes[(*count)++] = 2;
+
+    /* Bit k represents the odd integer 2k + 1 */
+    for (k = 1; k < nbits; k++) {
+        if (!get_bit(is_prime, k))
+            continue;
+        n = 2 * k + 1;
+        primes[(*count)++] = n;
+        if (n <= limit / n)
+            for (n = n * n / 2; n < nbits; n += 2 * k + 1)
+                clear_bit(is_prime, n);
+    }
+
+    delete_bitarray(&is_prime);
+
+    DEBUG_MSG("%lu primes up to %lu", *count, limit);
+
+    return primes;
+}
+
+/*
+ * FUNCTION:    isqrt
+ * DESCRIPTION: Computes the integer square root of a nonnegative integer.
+ * PARAMETERS:  n (const unsigned long): The number.
+ * RETURNS:     The largest r such that r * r <= n.
+ */
+unsigned long isqrt(const unsigned long n) {
+    unsigned long rem = n;  /* What is left of n after subtracting r * r */
+    unsigned long r = 0;    /* The square root found so far */
+    unsigned long bit;      /* The bit of the root being determined */
+
+    /* Start at the highest power of 4 that fits */
+    bit = 1UL << (sizeof(unsigned long) * CHAR_BIT - 2);
+    while (bit > n)
+        bit >>= 2;
+
+    /* Digit-by-digit calculation in base 2 */
+    while (bit) {
+        if (rem >= r + bit) {
+            rem -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return r;
+}
@@ -0,0 +1,13 @@
+/*
+ * FILE:        primes.h
+ * DESCRIPTION: Interface for generating tables of small primes, such as the
+ *              sieving primes used by the segmented algorithms.
+ */
+
+#ifndef PRIMES_H
+#define PRIMES_H
+
+unsigned long * small_primes(const unsigned long, unsigned long *);
+unsigned long isqrt(const unsigned long);
+
+#endif
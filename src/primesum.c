@@ -0,0 +1,289 @@
+/*
+ * FILE:        primesum.c
+ * DESCRIPTION: Implementation of sums over the primes with the Lucy_Hedgehog
+ *              (Legendre-style) dynamic programming algorithm. Let S(v) be the
+ *              sum of f(i) over 2 <= i <= v, where f(i) = i^k. The only values
+ *              of v ever needed are floor(n / i), of which there are about
+ *              2 sqrt(n). For each prime p <= sqrt(n) in increasing order,
+ *              every S(v) with v >= p^2 drops the terms of the integers whose
+ *              smallest prime factor is p:
+ *
+ *                  S(v) -= f(p) * (S(v / p) - S(p - 1)).
+ *
+ *              Afterwards S(v) is the sum of f(p) over the primes p <= v. This
+ *              takes about O(n^(3/4)) time and O(sqrt(n)) memory.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "primes.h"
+#include "primesum.h"
+#include "debug.h"
+
+#define ERR_TABLE_ALLOCATE  "sieve: prime sum table"
+
+/* Static ("private") function prototypes */
+static unsigned long addmod(const unsigned long, const unsigned long,
+        const unsigned long);
+static unsigned long submod(const unsigned long, const unsigned long,
+        const unsigned long);
+static unsigned long mulmod(const unsigned long, const unsigned long,
+        const unsigned long);
+static unsigned long powmod(unsigned long, unsigned, const unsigned long);
+static unsigned long power_sum(const unsigned long, const unsigned,
+        const unsigned long, const unsigned long *);
+
+/*
+ * FUNCTION:    prime_sum
+ * DESCRIPTION: Computes the sum of the primes less than or equal to n exactly,
+ *              using 128-bit accumulators.
+ * PARAMETERS:  n (const unsigned long): The upper bound.
+ * RETURNS:     The sum of the primes less than or equal to n.
+ */
+uint128 prime_sum(const unsigned long n) {
+    const unsigned long r = isqrt(n);   /* Boundary of the small values */
+    uint128 *small = NULL;  /* small[v] = S(v) for v <= r */
+    uint128 *large = NULL;  /* large[i] = S(n / i) for i <= r */
+    unsigned long *primes = NULL;       /* The primes up to r */
+    unsigned long nprimes;              /* The number of primes up to r */
+    unsigned long i, j;                 /* Loop indices */
+    unsigned long p, p2;                /* A prime and its square */
+    unsigned long v;                    /* An argument of S */
+    uint128 sp;                         /* S(p - 1) */
+    uint128 sum;                        /* The result */
+
+    if (n < 2)
+        return 0;
+
+    small = malloc((r + 1) * sizeof(uint128));
+    large = malloc((r + 1) * sizeof(uint128));
+    primes = small_primes(r, &nprimes);
+    if (!small || !large || !primes) {
+        perror(ERR_TABLE_ALLOCATE);
+        goto failure;
+    }
+
+    /* Before sieving, S(v) = 2 + 3 + ... + v */
+    for (v = 0; v <= r; v++)
+        small[v] = v ? (uint128) v * (v + 1) / 2 - 1 : 0;
+    for (i = 1; i <= r; i++) {
+        v = n / i;
+        large[i] = (uint128) v * (v + 1) / 2 - 1;
+    }
+
+    for (j = 0; j < nprimes; j++) {
+        p = primes[j];
+        p2 = p * p;
+        sp = small[p - 1];
+        for (i = 1; i <= r && n / i >= p2; i++)
+            large[i] -= p * ((i <= r / p ? large[i * p] : small[n / (i * p)])
+                    - sp);
+        for (v = r; v >= p2; v--)
+            small[v] -= p * (small[v / p] - sp);
+    }
+
+    sum = large[1];
+
+    DEBUG_MSG("Sum of the primes up to %lu computed with %lu sieving primes",
+            n, nprimes);
+
+    free(small);
+    free(large);
+    free(primes);
+    return sum;
+
+failure:
+    free(small);
+    free(large);
+    free(primes);
+    exit(EXIT_FAILURE);
+}
+
+/*
+ * FUNCTION:    prime_power_sum
+ * DESCRIPTION: Computes the sum of p^k modulo m over the primes p less than or
+ *              equal to n. With k = 0 this is the number of primes modulo m.
+ * PARAMETERS:  n (const unsigned long): The upper bound.
+ *              k (const unsigned): The exponent, at most PRIMESUM_MAX_EXP.
+ *              m (const unsigned long): The modulus, which must be positive.
+ * RETURNS:     The sum of p^k over the primes p <= n, modulo m.
+ */
+unsigned long prime_power_sum(const unsigned long n, const unsigned k,
+        const unsigned long m) {
+    const unsigned long r = isqrt(n);   /* Boundary of the small values */
+    unsigned long *small = NULL;        /* small[v] = S(v) for v <= r */
+    unsigned long *large = NULL;        /* large[i] = S(n / i) for i <= r */
+    unsigned long *primes = NULL;       /* The primes up to r */
+    unsigned long *stirling = NULL;     /* Stirling numbers S2(k, j) mod m */
+    unsigned long nprimes;              /* The number of primes up to r */
+    unsigned long i, j;                 /* Loop indices */
+    unsigned long p, p2;                /* A prime and its square */
+    unsigned long fp;                   /* p^k mod m */
+    unsigned long v;                    /* An argument of S */
+    unsigned long sp;                   /* S(p - 1) */
+    unsigned long t;                    /* A term being subtracted */
+    unsigned long sum;                  /* The result */
+
+    if (n < 2 || m == 1)
+        return 0;
+
+    small = malloc((r + 1) * sizeof(unsigned long));
+    large = malloc((r + 1) * sizeof(unsigned long));
+    stirling = calloc((size_t) k + 1, sizeof(unsigned long));
+    primes = small_primes(r, &nprimes);
+    if (!small || !large || !stirling || !primes) {
+        perror(ERR_TABLE_ALLOCATE);
+        goto failure;
+    }
+
+    /* Row k of the Stirling numbers of the second kind, built row by row
+     * from S2(i, j) = j S2(i - 1, j) + S2(i - 1, j - 1) */
+    stirling[0] = 1 % m;
+    for (i = 1; i <= k; i++) {
+        for (j = i; j > 0; j--)
+            stirling[j] = addmod(mulmod(j, stirling[j], m), stirling[j - 1], m);
+        stirling[0] = 0;
+    }
+
+    /* Before sieving, S(v) = 2^k + 3^k + ... + v^k */
+    for (v = 0; v <= r; v++)
+        small[v] = v ? submod(power_sum(v, k, m, stirling), 1 % m, m) : 0;
+    for (i = 1; i <= r; i++)
+        large[i] = submod(power_sum(n / i, k, m, stirling), 1 % m, m);
+
+    for (j = 0; j < nprimes; j++) {
+        p = primes[j];
+        p2 = p * p;
+        fp = powmod(p, k, m);
+        sp = small[p - 1];
+        for (i = 1; i <= r && n / i >= p2; i++) {
+            t = i <= r / p ? large[i * p] : small[n / (i * p)];
+            large[i] = submod(large[i], mulmod(fp, submod(t, sp, m), m), m);
+        }
+        for (v = r; v >= p2; v--) {
+            t = mulmod(fp, submod(small[v / p], sp, m), m);
+            small[v] = submod(small[v], t, m);
+        }
+    }
+
+    sum = large[1];
+
+    free(small);
+    free(large);
+    free(stirling);
+    free(primes);
+    return sum;
+
+failure:
+    free(small);
+    free(large);
+    free(stirling);
+    free(primes);
+    exit(EXIT_FAILURE);
+}
+
+/*
+ * FUNCTION:    power_sum
+ * DESCRIPTION: Computes 1^k + 2^k + ... + v^k modulo m. For k > 0 this uses
+ *              the identity
+ *
+ *                  1^k + ... + v^k = sum over j of S2(k, j) j! C(v + 1, j + 1),
+ *
+ *              where j! C(v + 1, j + 1) is the product of the j + 1
+ *              consecutive integers v + 1 - j, ..., v + 1 divided by j + 1.
+ *              Exactly one of those integers is divisible by j + 1, so the
+ *              division is done exactly before reducing modulo m, which need
+ *              not be prime.
+ * PARAMETERS:  v (const unsigned long): The number of terms.
+ *              k (const unsigned): The exponent.
+ *              m (const unsigned long): The modulus.
+ *              stirling (const unsigned long *): S2(k, j) mod m for j <= k.
+ * RETURNS:     The sum modulo m.
+ */
+static unsigned long power_sum(const unsigned long v, const unsigned k,
+        const unsigned long m, const unsigned long *stirling) {
+    unsigned long sum = 0;      /* The sum so far */
+    unsigned long term;         /* j! C(v + 1, j + 1) mod m */
+    unsigned long factor;       /* One of the consecutive integers */
+    unsigned long j, t;         /* Loop indices */
+
+    if (k == 0)
+        return v % m;
+
+    /* Terms with j > v vanish since then C(v + 1, j + 1) = 0 */
+    for (j = 1; j <= k && j <= v; j++) {
+        if (!stirling[j])
+            continue;
+        term = 1 % m;
+        for (t = 0; t <= j; t++) {
+            /* (v + 1 - t) computed as (v - t) + 1 so v = ULONG_MAX is safe */
+            factor = v - t;
+            if ((factor % (j + 1) + 1) % (j + 1) == 0)
+                term = mulmod(term, (factor / (j + 1)
+                        + (factor % (j + 1) + 1) / (j + 1)) % m, m);
+            else
+                term = mulmod(term, (factor % m + 1) % m, m);
+        }
+        sum = addmod(sum, mulmod(stirling[j], term, m), m);
+    }
+
+    return sum;
+}
+
+/*
+ * FUNCTION:    addmod
+ * DESCRIPTION: Adds two residues modulo m without overflow.
+ * PARAMETERS:  a, b (const unsigned long): The terms, both less than m.
+ *              m (const unsigned long): The modulus.
+ * RETURNS:     a + b mod m.
+ */
+static unsigned long addmod(const unsigned long a, const unsigned long b,
+        const unsigned long m) {
+    return a >= m - b ? a - (m - b) : a + b;
+}
+
+/*
+ * FUNCTION:    submod
+ * DESCRIPTION: Subtracts two residues modulo m without overflow.
+ * PARAMETERS:  a, b (const unsigned long): The terms, both less than m.
+ *              m (const unsigned long): The modulus.
+ * RETURNS:     a - b mod m.
+ */
+static unsigned long submod(const unsigned long a, const unsigned long b,
+        const unsigned long m) {
+    return a >= b ? a - b : a + (m - b);
+}
+
+/*
+ * FUNCTION:    mulmod
+ * DESCRIPTION: Multiplies two residues modulo m without overflow.
+ * PARAMETERS:  a, b (const unsigned long): The factors, both less than m.
+ *              m (const unsigned long): The modulus.
+ * RETURNS:     a * b mod m.
+ */
+static unsigned long mulmod(const unsigned long a, const unsigned long b,
+        const unsigned long m) {
+    return (unsigned long) ((uint128) a * b % m);
+}
+
+/*
+ * FUNCTION:    powmod
+ * DESCRIPTION: Raises a number to a power modulo m by repeated squaring.
+ * PARAMETERS:  a (unsigned long): The base.
+ *              k (unsigned): The exponent.
+ *              m (const unsigned long): The modulus.
+ * RETURNS:     a^k mod m.
+ */
+static unsigned long powmod(unsigned long a, unsigned k,
+        const unsigned long m) {
+    unsigned long result = 1 % m;
+    a %= m;
+    while (k) {
+        if (k & 1)
+            result = mulmod(result, a, m);
+        a = mulmod(a, a, m);
+        k >>= 1;
+    }
+    return result;
+}
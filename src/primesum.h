@@ -0,0 +1,20 @@
+/*
+ * FILE:        primesum.h
+ * DESCRIPTION: Function prototypes for summing the primes up to a given number
+ *              (or their kth powers modulo a given number) without listing
+ *              them.
+ */
+
+#ifndef PRIMESUM_H
+#define PRIMESUM_H
+
+#include "uint128.h"
+
+/* Largest exponent accepted by prime_power_sum */
+#define PRIMESUM_MAX_EXP 255
+
+uint128 prime_sum(const unsigned long);
+unsigned long prime_power_sum(const unsigned long, const unsigned,
+        const unsigned long);
+
+#endif
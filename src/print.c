@@ -0,0 +1,58 @@
+/*
+ * FILE:        print.c
+ * DESCRIPTION: Implementation of fast integer printing. The digits are built
+ *              from the least significant end and written with putchar,
+ *              avoiding the format parsing done by printf.
+ */
+
+#include <stdio.h>
+
+#include "print.h"
+
+#define BASE 10
+#define TOCHAR(d) ((char) ('0' + (d)))
+
+/* Enough room for the digits of a 128-bit integer and a null character */
+#define MAX_DIGITS 40
+
+/*
+ * FUNCTION:    printul
+ * DESCRIPTION: Prints an unsigned long to stdout (in decimal). This function
+ *              automatically appends a newline at the end.
+ * PARAMETERS:  n (unsigned long): The number to be printed.
+ * RETURNS:     Nothing.
+ */
+void printul(unsigned long n) {
+    char digits[MAX_DIGITS + 1];
+    char *digit = digits;
+    *digit++ = '\0';
+    do {
+        *digit++ = TOCHAR(n % BASE);
+        n /= BASE;
+    } while (n);
+    while (*--digit) {
+        putchar(*digit);
+    }
+    putchar('\n');
+}
+
+/*
+ * FUNCTION:    printu128
+ * DESCRIPTION: Prints a 128-bit unsigned integer to stdout (in decimal). This
+ *              function automatically appends a newline at the end.
+ * PARAMETERS:  n (uint128): The number to be printed.
+ * RETURNS:     Nothing.
+ */
+void printu128(uint128 n) {
+    char digits[MAX_DIGITS + 1];
+    char *digit = digits;
+    *digit++ = '\0';
+    do {
+        *digit++ = TOCHAR((unsigned) (n % BASE));
+        n /= BASE;
+    } while (n);
+    while (*--digit) {
+        putchar(*digit);
+    }
+    putchar('\n');
+}
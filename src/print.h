@@ -0,0 +1,14 @@
+/*
+ * FILE:        print.h
+ * DESCRIPTION: Function prototypes for printing integers to stdout quickly.
+ */
+
+#ifndef PRINT_H
+#define PRINT_H
+
+#include "uint128.h"
+
+void printul(unsigned long);
+void printu128(uint128);
+
+#endif
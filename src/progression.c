@@ -0,0 +1,209 @@
+/*
+ * FILE:        progression.c
+ * DESCRIPTION: Implementation of the sieve of Eratosthenes restricted to one
+ *              residue class a mod q. Only the numbers a + q i are stored, one
+ *              bit each. A sieving prime p that does not divide q divides
+ *              a + q i exactly when i is congruent to -a / q mod p, so its
+ *              multiples in the progression are every pth bit starting from a
+ *              modular offset. Compared with sieving all the odd numbers this
+ *              takes about q / 2 times less memory.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "bitarray.h"
+#include "primes.h"
+#include "print.h"
+#include "uint128.h"
+#include "progression.h"
+#include "debug.h"
+
+#define ERR_BIT_ALLOCATE    "sieve: bit array"
+#define ERR_PRIMES_ALLOCATE "sieve: sieving primes"
+
+/* Static ("private") function prototypes */
+static unsigned long sieve_progression(const unsigned long, unsigned long,
+        const unsigned long, const int);
+static unsigned long gcd(unsigned long, unsigned long);
+static unsigned long invmod(const unsigned long, const unsigned long);
+static int is_prime(const unsigned long);
+
+/*
+ * FUNCTION:    progression_count
+ * DESCRIPTION: Counts the primes p <= max with p congruent to a mod q.
+ * PARAMETERS:  max (const unsigned long): The upper bound.
+ *              a (const unsigned long): The residue.
+ *              q (const unsigned long): The modulus, which must be positive.
+ * RETURNS:     The number of such primes.
+ */
+unsigned long progression_count(const unsigned long max, const unsigned long a,
+        const unsigned long q) {
+    return sieve_progression(max, a, q, 0);
+}
+
+/*
+ * FUNCTION:    progression_list
+ * DESCRIPTION: Prints the primes p <= max with p congruent to a mod q to
+ *              stdout, one per line.
+ * PARAMETERS:  max (const unsigned long): The upper bound.
+ *              a (const unsigned long): The residue.
+ *              q (const unsigned long): The modulus, which must be positive.
+ * RETURNS:     Nothing.
+ */
+void progression_list(const unsigned long max, const unsigned long a,
+        const unsigned long q) {
+    (void) sieve_progression(max, a, q, 1);
+}
+
+/*
+ * FUNCTION:    sieve_progression
+ * DESCRIPTION: Sieve the progression a, a + q, a + 2q, ... up to max.
+ * PARAMETERS:  max (const unsigned long): The upper bound.
+ *              a (unsigned long): The residue.
+ *              q (const unsigned long): The modulus.
+ *              list (const int): If nonzero, print the primes found.
+ * RETURNS:     The number of primes found.
+ */
+static unsigned long sieve_progression(const unsigned long max,
+        unsigned long a, const unsigned long q, const int list) {
+    struct bitarray *terms = NULL;      /* Bit i represents a + q i */
+    unsigned long *primes = NULL;       /* The sieving primes */
+    unsigned long nprimes;              /* The number of sieving primes */
+    unsigned long nbits;                /* Terms of the progression <= max */
+    unsigned long count = 0;            /* The number of primes found */
+    unsigned long i, j;                 /* Loop indices */
+    unsigned long p;                    /* A sieving prime */
+    uint128 n;                          /* A term of the progression */
+
+    a %= q;
+    if (a > max)
+        return 0;
+
+    /* If a and q share a factor, every term is divisible by it, so only the
+     * smallest positive term (a, or q if a is 0) can be prime */
+    if (gcd(a, q) != 1) {
+        if ((a ? a : q) > max || !is_prime(a ? a : q))
+            return 0;
+        if (list)
+            printul(a ? a : q);
+        return 1;
+    }
+
+    nbits = (max - a) / q + 1;
+    terms = new_bitarray(nbits);
+    if (!terms) {
+        perror(ERR_BIT_ALLOCATE);
+        goto failure;
+    }
+    set_all_bits(terms);
+
+    /* 0 and 1 are not prime */
+    for (i = 0; i < nbits && a + q * i < 2; i++)
+        clear_bit(terms, i);
+
+    primes = small_primes(isqrt(max), &nprimes);
+    if (!primes) {
+        perror(ERR_PRIMES_ALLOCATE);
+        goto failure;
+    }
+
+    for (j = 0; j < nprimes; j++) {
+        p = primes[j];
+        if (q % p == 0)
+            continue;   /* p never divides a term */
+
+        /* First term divisible by p, then the first one that is at least
+         * p^2 (smaller multiples of p are p itself or were already crossed
+         * off by a smaller prime) */
+        i = (unsigned long) ((uint128) ((p - a % p) % p) * invmod(q % p, p)
+                % p);
+        n = (uint128) q * i + a;
+        if (n < (uint128) p * p)
+            i += (unsigned long) (((uint128) p * p - n + (uint128) q * p - 1)
+                    / ((uint128) q * p)) * p;
+
+        /* Cross off every pth term from there */
+        for (; i < nbits; i += p)
+            clear_bit(terms, i);
+    }
+
+    for (i = next_set_bit(terms, 0, nbits); i < nbits;
+            i = next_set_bit(terms, i + 1, nbits)) {
+        count++;
+        if (list)
+            printul(a + q * i);
+    }
+
+    DEBUG_MSG("%lu primes congruent to %lu mod %lu up to %lu",
+            count, a, q, max);
+
+    delete_bitarray(&terms);
+    free(primes);
+    return count;
+
+failure:
+    delete_bitarray(&terms);
+    free(primes);
+    exit(EXIT_FAILURE);
+}
+
+/*
+ * FUNCTION:    gcd
+ * DESCRIPTION: Computes the greatest common divisor with Euclid's algorithm.
+ * PARAMETERS:  a, b (unsigned long): The numbers.
+ * RETURNS:     gcd(a, b).
+ */
+static unsigned long gcd(unsigned long a, unsigned long b) {
+    while (b) {
+        unsigned long t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/*
+ * FUNCTION:    invmod
+ * DESCRIPTION: Computes a modular inverse with the extended Euclidean
+ *              algorithm.
+ * PARAMETERS:  a (const unsigned long): The number to invert, which must be
+ *              coprime to m.
+ *              m (const unsigned long): The modulus.
+ * RETURNS:     The x in [0, m) with a x congruent to 1 mod m.
+ */
+static unsigned long invmod(const unsigned long a, const unsigned long m) {
+    long t = 0, new_t = 1, tmp;     /* Bezout coefficients of a */
+    unsigned long r = m, new_r = a; /* Remainders */
+    unsigned long quot, rtmp;
+
+    if (m == 1)
+        return 0;
+
+    while (new_r) {
+        quot = r / new_r;
+        tmp = t - (long) quot * new_t;
+        t = new_t;
+        new_t = tmp;
+        rtmp = r - quot * new_r;
+        r = new_r;
+        new_r = rtmp;
+    }
+    return t < 0 ? (unsigned long) (t + (long) m) : (unsigned long) t;
+}
+
+/*
+ * FUNCTION:    is_prime
+ * DESCRIPTION: Trial division primality test.
+ * PARAMETERS:  n (const unsigned long): The number to test.
+ * RETURNS:     1 if n is prime, 0 otherwise.
+ */
+static int is_prime(const unsigned long n) {
+    unsigned long d;
+    if (n < 2)
+        return 0;
+    for (d = 2; d <= n / d; d++)
+        if (n % d == 0)
+            return 0;
+    return 1;
+}
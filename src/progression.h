@@ -0,0 +1,15 @@
+/*
+ * FILE:        progression.h
+ * DESCRIPTION: Function prototypes for sieving the primes in a single residue
+ *              class (arithmetic progression) a mod q.
+ */
+
+#ifndef PROGRESSION_H
+#define PROGRESSION_H
+
+unsigned long progression_count(const unsigned long, const unsigned long,
+        const unsigned long);
+void progression_list(const unsigned long, const unsigned long,
+        const unsigned long);
+
+#endif
@@ -0,0 +1,762 @@
+/*
+ * FILE:        segment.c
+ * DESCRIPTION: Implementation of segmented sieves. Each block holds one bit per
+ *              odd integer. The sieving primes are stored as the halved gaps
+ *              between consecutive odd primes, one byte each (every such gap
+ *              below 2^32 is at most 336), so even the 203 million primes
+ *              needed for windows near 2^64 take about 200 MB.
+ *              All arithmetic on the sieved numbers is done on bit indices
+ *              within a block, or guarded against overflow, so a range may end
+ *              at ULONG_MAX.
+ *              Nothing is sieved up front: the sieving primes are extended
+ *              (at least doubling their limit) only when a block needs them,
+ *              and the blocks start small and double up to BLOCK_BITS, so the
+ *              first primes come out right away even for an unbounded range.
+ *              A prime only takes part once the sieve reaches its square, and
+ *              from then on its next multiple is carried from block to block,
+ *              so it costs a single division. The primes below BLOCK_BITS hit
+ *              every block and are walked each time; the larger ones hit a
+ *              block at most once, so each waits in the bucket of the block it
+ *              hits next (as in Oliveira e Silva's bucket sieve), and is
+ *              dropped once its next multiple is past the end of the range.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include "bitarray.h"
+#include "primes.h"
+#include "segment.h"
+#include "debug.h"
+
+/* Number of odd integers in a block (256 KiB of bits) */
+#define BLOCK_BITS (1UL << 21)
+
+/* Number of odd integers in the first block */
+#define FIRST_BLOCK_BITS (1UL << 12)
+
+/* Number of buckets, more than the blocks from one multiple of a sieving prime
+ * (less than 2^32) to the next, so the buckets can be reused in a cycle */
+#define NBUCKETS 4096
+
+/* Number of hits in a chunk of a bucket */
+#define CHUNK_HITS 1024
+
+/*
+ * STRUCT:      small
+ * DESCRIPTION: A sieving prime below BLOCK_BITS.
+ * FIELDS:      p (unsigned long): The prime.
+ *              k (unsigned long): The bit of its next odd multiple, counted
+ *              from bit 0 of the current block (it may be past the block).
+ */
+struct small {
+    unsigned long p;
+    unsigned long k;
+};
+
+/*
+ * STRUCT:      hit
+ * DESCRIPTION: A sieving prime of at least BLOCK_BITS, waiting in the bucket
+ *              of the block its next odd multiple is in.
+ * FIELDS:      p (uint32_t): The prime.
+ *              k (uint32_t): The bit of its next odd multiple in that block.
+ */
+struct hit {
+    uint32_t p;
+    uint32_t k;
+};
+
+/*
+ * STRUCT:      chunk
+ * DESCRIPTION: Part of a bucket: a fixed number of hits, so that the buckets
+ *              share one pool of chunks and memory follows the number of
+ *              primes waiting rather than the most any one bucket ever held.
+ * FIELDS:      next (struct chunk *): The rest of the bucket (or the pool).
+ *              n (unsigned long): The number of hits used.
+ *              hits (struct hit [CHUNK_HITS]): The primes and where they hit.
+ */
+struct chunk {
+    struct chunk *next;
+    unsigned long n;
+    struct hit hits[CHUNK_HITS];
+};
+
+/*
+ * STRUCT:      segsieve
+ * DESCRIPTION: The state of a segmented sieve over [lo, hi].
+ * FIELDS:      hi (unsigned long): The end of the range.
+ *              two (int): 1 if the prime 2 is in the range and has not been
+ *              reported yet.
+ *              block (struct bitarray *): The current block. Bit i represents
+ *              the odd integer base + 2 i.
+ *              base (unsigned long): The odd integer of bit 0.
+ *              nbits (unsigned long): The number of bits in use in the block.
+ *              size (unsigned long): The number of bits to use in the next
+ *              block (less at the end of the range).
+ *              pos (unsigned long): The next bit to look at in the block.
+ *              last (int): 1 if the current block reaches hi.
+ *              loaded (int): 1 once the first block has been sieved.
+ *              gaps (unsigned char *): Halved gaps between the odd sieving
+ *              primes, starting from 1: 3 = 1 + 2 gaps[0], 5 = 3 + 2 gaps[1],
+ *              and so on.
+ *              ngaps (unsigned long): The number of odd sieving primes.
+ *              cap (unsigned long): The capacity of gaps.
+ *              plimit (unsigned long): Every odd prime <= plimit is stored.
+ *              pmax (unsigned long): The largest stored prime (or 1).
+ *              nactive (unsigned long): The number of sieving primes in use.
+ *              pactive (unsigned long): The largest one in use (or 1).
+ *              smalls (struct small *): The primes in use below BLOCK_BITS.
+ *              nsmall (unsigned long): The number of such primes.
+ *              scap (unsigned long): The capacity of smalls.
+ *              buckets (struct chunk **): The larger primes in use, NBUCKETS
+ *              buckets, block j's in buckets[j % NBUCKETS] (NULL until the
+ *              first such prime).
+ *              pool (struct chunk *): The chunks not in any bucket.
+ *              grid (int): 1 once the blocks have BLOCK_BITS bits.
+ *              blockno (unsigned long): The number j of the current block,
+ *              counting from the first block of BLOCK_BITS bits.
+ *              lastblock (unsigned long): The number of the block with hi.
+ */
+struct segsieve {
+    unsigned long hi;
+    int two;
+    struct bitarray *block;
+    unsigned long base;
+    unsigned long nbits;
+    unsigned long size;
+    unsigned long pos;
+    int last;
+    int loaded;
+    unsigned char *gaps;
+    unsigned long ngaps;
+    unsigned long cap;
+    unsigned long plimit;
+    unsigned long pmax;
+    unsigned long nactive;
+    unsigned long pactive;
+    struct small *smalls;
+    unsigned long nsmall;
+    unsigned long scap;
+    struct chunk **buckets;
+    struct chunk *pool;
+    int grid;
+    unsigned long blockno;
+    unsigned long lastblock;
+};
+
+/* Static ("private") function prototypes */
+static int extend_primes(struct segsieve *, const unsigned long);
+static int add_gap(struct segsieve *, const unsigned long);
+static int activate(struct segsieve *, const unsigned long);
+static int add_hit(struct segsieve *, const unsigned long, const uint32_t,
+        const uint32_t);
+static void free_chunks(struct chunk *);
+static unsigned long first_bit(const unsigned long, const unsigned long);
+static int sieve_block(struct segsieve *);
+
+/*
+ * FUNCTION:    new_segsieve
+ * DESCRIPTION: Creates a segmented sieve for the primes in [lo, hi]. The
+ *              sieve is dynamically allocated and must be deallocated with
+ *              the delete_segsieve function.
+ * ERRORS:      If memory allocation fails, returns NULL.
+ * PARAMETERS:  lo (const unsigned long): The start of the range.
+ *              hi (const unsigned long): The end of the range (inclusive).
+ * RETURNS:     A pointer to the new sieve.
+ */
+struct segsieve * new_segsieve(const unsigned long lo, const unsigned long hi) {
+    struct segsieve *s = calloc(1, sizeof(struct segsieve));
+    if (!s)
+        return NULL;
+
+    s->hi = hi;
+    s->two = lo <= 2 && 2 <= hi;
+    s->base = lo | 1;   /* The first odd integer >= lo (can't overflow) */
+    s->plimit = 1;
+    s->pmax = 1;
+    s->pactive = 1;
+    /* Small blocks only pay off while there are few sieving primes */
+    for (s->size = FIRST_BLOCK_BITS; s->size < BLOCK_BITS
+            && s->size < isqrt(lo); s->size *= 2)
+        ;
+
+    /* An empty range needs no block at all */
+    if (lo > hi || s->base > hi) {
+        s->loaded = s->last = 1;
+        return s;
+    }
+
+    s->block = new_bitarray(BLOCK_BITS);
+    if (!s->block) {
+        delete_segsieve(&s);
+        return NULL;
+    }
+
+    DEBUG_MSG("New segmented sieve at %p (range: [%lu, %lu])",
+            (void *) s, lo, hi);
+
+    return s;
+}
+
+/*
+ * FUNCTION:    delete_segsieve
+ * DESCRIPTION: Deallocates all memory associated with a segmented sieve.
+ * PARAMETERS:  spp (struct segsieve **): A pointer to a pointer to the sieve
+ *              being deleted.
+ * RETURNS:     Nothing.
+ */
+void delete_segsieve(struct segsieve **spp) {
+    unsigned long j;    /* Loop index */
+
+    if (spp && *spp) {
+        DEBUG_MSG("Deleting segmented sieve at %p ...", (void *) *spp);
+
+        delete_bitarray(&(*spp)->block);
+        free((*spp)->gaps);
+        free((*spp)->smalls);
+        if ((*spp)->buckets)
+            for (j = 0; j < NBUCKETS; j++)
+                free_chunks((*spp)->buckets[j]);
+        free((*spp)->buckets);
+        free_chunks((*spp)->pool);
+        free(*spp);
+        *spp = NULL;
+    }
+}
+
+/*
+ * FUNCTION:    next_prime
+ * DESCRIPTION: Get the next prime in the range of a segmented sieve, sieving
+ *              the next block when the current one runs out.
+ * ERRORS:      If memory for more sieving primes can't be allocated, returns
+ *              -1.
+ * PARAMETERS:  s (struct segsieve *): The sieve.
+ *              p (unsigned long *): Set to the next prime, if there is one.
+ * RETURNS:     1 if a prime was found, 0 if the range is exhausted, or -1 on
+ *              failure.
+ */
+int next_prime(struct segsieve *s, unsigned long *p) {
+    unsigned long k;    /* Index of the next surviving bit */
+
+    if (s->two) {
+        s->two = 0;
+        *p = 2;
+        return 1;
+    }
+
+    for (;;) {
+        if (s->loaded) {
+            k = next_set_bit(s->block, s->pos, s->nbits);
+            if (k < s->nbits) {
+                s->pos = k + 1;
+                *p = s->base + 2 * k;
+                return 1;
+            }
+            if (s->last)
+                return 0;
+            /* Move past the current block; this can't overflow since hi is
+             * beyond it */
+            s->base += 2 * s->nbits;
+        }
+        if (sieve_block(s))
+            return -1;
+    }
+}
+
+/*
+ * FUNCTION:    sieve_block
+ * DESCRIPTION: Sieve the block of odd integers starting at s->base, first
+ *              extending the sieving primes if the block needs more, and
+ *              leave each sieving prime at its next multiple past the block.
+ * ERRORS:      If memory for more sieving primes can't be allocated, returns
+ *              -1.
+ * PARAMETERS:  s (struct segsieve *): The sieve.
+ * RETURNS:     0 on success, -1 on failure.
+ */
+static int sieve_block(struct segsieve *s) {
+    unsigned long p;        /* A sieving prime */
+    unsigned long block_hi; /* The last odd integer in the block */
+    unsigned long limit;    /* The sieving primes needed */
+    unsigned long i, k;     /* Loop indices */
+    struct small *sp;       /* A small sieving prime */
+    struct chunk *chunk;    /* The larger primes hitting the block */
+    struct chunk *next;     /* The chunk after it */
+    struct hit *hit;        /* One of them */
+
+    /* The blocks of BLOCK_BITS bits are numbered, for the buckets; the smaller
+     * ones before them only need primes below BLOCK_BITS (the first block has
+     * at least isqrt(lo) bits, so sqrt(block_hi) stays below twice that) */
+    if (s->size == BLOCK_BITS) {
+        if (s->grid) {
+            s->blockno++;
+        } else {
+            s->grid = 1;
+            s->lastblock = (s->hi - s->base) / 2 / BLOCK_BITS;
+        }
+    }
+
+    /* Number of odd integers left in [base, hi], without computing hi + 1 */
+    if ((s->hi - s->base) / 2 < s->size) {
+        s->nbits = (s->hi - s->base) / 2 + 1;
+        s->last = 1;
+    } else {
+        s->nbits = s->size;
+    }
+    block_hi = s->base + 2 * (s->nbits - 1);
+    if (s->size < BLOCK_BITS)
+        s->size *= 2;
+
+    /* Extend the sieving primes geometrically, but never past sqrt(hi) */
+    limit = isqrt(block_hi);
+    if (limit > s->plimit) {
+        if (limit < 2 * s->plimit)
+            limit = 2 * s->plimit;
+        if (limit > isqrt(s->hi))
+            limit = isqrt(s->hi);
+        if (extend_primes(s, limit))
+            return -1;
+    }
+
+    /* Bring in the primes whose squares are now reached */
+    for (; s->nactive < s->ngaps; s->nactive++) {
+        p = s->pactive + 2 * (unsigned long) s->gaps[s->nactive];
+        if (p > block_hi / p)
+            break;
+        if (activate(s, p))
+            return -1;
+        s->pactive = p;
+    }
+
+    set_all_bits(s->block);
+    if (s->base == 1)
+        clear_bit(s->block, 0);     /* 1 is not prime */
+
+    for (i = 0; i < s->nsmall; i++) {
+        sp = &s->smalls[i];
+        k = sp->k;
+        if (k < s->nbits) {
+            clear_stride(s->block, k, sp->p, s->nbits);
+            k += (s->nbits - k + sp->p - 1) / sp->p * sp->p;
+        }
+        sp->k = k - s->nbits;
+    }
+
+    /* The hits move on to later buckets, never this one, and the emptied
+     * chunks go back to the pool */
+    chunk = s->buckets ? s->buckets[s->blockno % NBUCKETS] : NULL;
+    if (chunk)
+        s->buckets[s->blockno % NBUCKETS] = NULL;
+    for (; chunk; chunk = next) {
+        for (i = 0; i < chunk->n; i++) {
+            hit = &chunk->hits[i];
+            /* Only the last block can end before the hit */
+            if (hit->k < s->nbits)
+                clear_bit(s->block, hit->k);
+            k = (unsigned long) hit->k + hit->p;
+            if (add_hit(s, s->blockno + k / BLOCK_BITS, hit->p,
+                        (uint32_t) (k % BLOCK_BITS))) {
+                free_chunks(chunk);
+                return -1;
+            }
+        }
+        next = chunk->next;
+        chunk->next = s->pool;
+        s->pool = chunk;
+    }
+
+    s->pos = 0;
+    s->loaded = 1;
+    return 0;
+}
+
+/*
+ * FUNCTION:    activate
+ * DESCRIPTION: Start sieving the current block and the ones after it with an
+ *              odd prime, from its first odd multiple that is at least p^2 and
+ *              in the block or past it.
+ * ERRORS:      If memory allocation fails, returns -1.
+ * PARAMETERS:  s (struct segsieve *): The sieve.
+ *              p (const unsigned long): The prime, with p * p <= the last
+ *              integer in the block.
+ * RETURNS:     0 on success, -1 on failure.
+ */
+static int activate(struct segsieve *s, const unsigned long p) {
+    unsigned long k = first_bit(s->base, p);    /* Bit of the first multiple */
+    struct small *smalls;                       /* The reallocated smalls */
+
+    if (p >= BLOCK_BITS) {
+        /* k < p, so this fits the buckets */
+        return add_hit(s, s->blockno + k / BLOCK_BITS, (uint32_t) p,
+                (uint32_t) (k % BLOCK_BITS));
+    }
+
+    if (s->nsmall == s->scap) {
+        s->scap = s->scap ? 2 * s->scap : FIRST_BLOCK_BITS;
+        smalls = realloc(s->smalls, s->scap * sizeof(struct small));
+        if (!smalls)
+            return -1;
+        s->smalls = smalls;
+    }
+    s->smalls[s->nsmall].p = p;
+    s->smalls[s->nsmall++].k = k;
+    return 0;
+}
+
+/*
+ * FUNCTION:    add_hit
+ * DESCRIPTION: Put a sieving prime of at least BLOCK_BITS in the bucket of
+ *              the block its next odd multiple is in, unless that block is
+ *              past the end of the range.
+ * ERRORS:      If memory allocation fails, returns -1.
+ * PARAMETERS:  s (struct segsieve *): The sieve.
+ *              j (const unsigned long): The number of the block.
+ *              p (const uint32_t): The prime.
+ *              k (const uint32_t): The bit of the multiple in block j.
+ * RETURNS:     0 on success, -1 on failure.
+ */
+static int add_hit(struct segsieve *s, const unsigned long j, const uint32_t p,
+        const uint32_t k) {
+    struct chunk **bucket;  /* The bucket of block j */
+    struct chunk *chunk;    /* A new first chunk for it */
+
+    if (j > s->lastblock)
+        return 0;
+    if (!s->buckets && !(s->buckets = calloc(NBUCKETS, sizeof(*s->buckets))))
+        return -1;
+
+    bucket = &s->buckets[j % NBUCKETS];
+    if (!*bucket || (*bucket)->n == CHUNK_HITS) {
+        if (s->pool) {
+            chunk = s->pool;
+            s->pool = chunk->next;
+        } else if (!(chunk = malloc(sizeof(struct chunk)))) {
+            return -1;
+        }
+        chunk->next = *bucket;
+        chunk->n = 0;
+        *bucket = chunk;
+    }
+    (*bucket)->hits[(*bucket)->n].p = p;
+    (*bucket)->hits[(*bucket)->n++].k = k;
+    return 0;
+}
+
+/*
+ * FUNCTION:    free_chunks
+ * DESCRIPTION: Deallocates a list of chunks.
+ * PARAMETERS:  chunk (struct chunk *): The first chunk, or NULL.
+ * RETURNS:     Nothing.
+ */
+static void free_chunks(struct chunk *chunk) {
+    struct chunk *next; /* The chunk after the one being freed */
+
+    for (; chunk; chunk = next) {
+        next = chunk->next;
+        free(chunk);
+    }
+}
+
+/*
+ * FUNCTION:    first_bit
+ * DESCRIPTION: Find the first odd multiple of an odd prime p that is at least
+ *              p^2 and at least base, as a bit index counted from base.
+ * PARAMETERS:  base (const unsigned long): The odd integer of bit 0.
+ *              p (const unsigned long): The prime, with p * p <= ULONG_MAX.
+ * RETURNS:     The bit index of the multiple.
+ */
+static unsigned long first_bit(const unsigned long base,
+        const unsigned long p) {
+    unsigned long d;    /* Distance from base to the next multiple of p */
+
+    if (p * p >= base)
+        return (p * p - base) / 2;
+
+    /* base + d is a multiple of p; it is odd if d is even, otherwise the next
+     * one, d + p further, is */
+    d = (p - base % p) % p;
+    return d % 2 ? (d + p) / 2 : d / 2;
+}
+
+/*
+ * FUNCTION:    extend_primes
+ * DESCRIPTION: Store all the odd primes up to a new limit as sieving primes,
+ *              by sieving the odd integers above the current limit block by
+ *              block with the primes up to the square root of the new limit.
+ * ERRORS:      If memory allocation fails, returns -1.
+ * PARAMETERS:  s (struct segsieve *): The sieve.
+ *              limit (const unsigned long): The new limit, less than 2^32.
+ * RETURNS:     0 on success, -1 on failure.
+ */
+static int extend_primes(struct segsieve *s, const unsigned long limit) {
+    struct bitarray *bits = NULL;   /* One block of odd integers */
+    unsigned long *small = NULL;    /* The primes up to sqrt(limit) */
+    unsigned long nsmall;           /* The number of such primes */
+    unsigned long base;             /* The odd integer of bit 0 */
+    unsigned long nbits;            /* The number of bits in use */
+    unsigned long i, k;             /* Loop indices */
+    int status = -1;                /* Return value */
+
+    if (limit <= s->plimit)
+        return 0;
+
+    bits = new_bitarray(BLOCK_BITS);
+    small = small_primes(isqrt(limit), &nsmall);
+    if (!bits || !small)
+        goto end;
+
+    for (base = s->plimit + 1 + (s->plimit % 2); base <= limit;
+            base += 2 * nbits) {
+        nbits = (limit - base) / 2 + 1;
+        if (nbits > BLOCK_BITS)
+            nbits = BLOCK_BITS;
+
+        set_all_bits(bits);
+        if (base == 1)
+            clear_bit(bits, 0);
+        /* The first small prime is 2, which never divides an odd integer */
+        for (i = 1; i < nsmall && small[i] <= (base + 2 * (nbits - 1))
+                / small[i]; i++)
+            clear_stride(bits, first_bit(base, small[i]), small[i], nbits);
+
+        for (k = next_set_bit(bits, 0, nbits); k < nbits;
+                k = next_set_bit(bits, k + 1, nbits))
+            if (add_gap(s, base + 2 * k))
+                goto end;
+    }
+
+    s->plimit = limit;
+    status = 0;
+
+end:
+    delete_bitarray(&bits);
+    free(small);
+    return status;
+}
+
+/*
+ * FUNCTION:    add_gap
+ * DESCRIPTION: Append an odd prime, larger than every stored prime, to the
+ *              sieving primes.
+ * ERRORS:      If memory allocation fails, returns -1.
+ * PARAMETERS:  s (struct segsieve *): The sieve.
+ *              p (const unsigned long): The prime.
+ * RETURNS:     0 on success, -1 on failure.
+ */
+static int add_gap(struct segsieve *s, const unsigned long p) {
+    unsigned char *gaps;    /* The reallocated gaps */
+
+    if (s->ngaps == s->cap) {
+        s->cap = s->cap ? 2 * s->cap : BLOCK_BITS / CHAR_BIT;
+        gaps = realloc(s->gaps, s->cap);
+        if (!gaps)
+            return -1;
+        s->gaps = gaps;
+    }
+    s->gaps[s->ngaps++] = (unsigned char) ((p - s->pmax) / 2);
+    s->pmax = p;
+    return 0;
+}
+
+/* Compile with -D'TEST' to enable testing of next_prime */
+#ifdef TEST
+
+#include <stdio.h>
+#include <string.h>
+
+#include "uint128.h"
+
+#define TEST_SMALL  24      /* Every range within [0, TEST_SMALL] is tried */
+#define TEST_PLAIN  (1UL << 26) /* Largest sqrt(hi) for the plain sieve */
+#define TEST_DIV    1000    /* Limit of trial division before Miller-Rabin */
+
+/* Test helper prototypes */
+static unsigned long check(const unsigned long, const unsigned long);
+static unsigned char * reference(const unsigned long, const unsigned long);
+static int is_prime(const unsigned long, const unsigned long *,
+        const unsigned long);
+static unsigned long powmod(unsigned long, unsigned long,
+        const unsigned long);
+
+/*
+ * FUNCTION:    main
+ * DESCRIPTION: Compares the primes next_prime finds in a number of ranges
+ *              with a plain sieve of each whole range at once: every range
+ *              within [0, TEST_SMALL] (so empty ranges, ranges of one number,
+ *              and each parity of lo and hi), ranges from 0 ending on and next
+ *              to each boundary between the growing first blocks, ranges of a
+ *              few full blocks with odd and even ends, with and without
+ *              sieving primes above a block, and windows ending at and just
+ *              below ULONG_MAX (checked with Miller-Rabin instead, since a
+ *              plain sieve would need the primes up to 2^32).
+ * RETURNS:     EXIT_SUCCESS if every range agrees, EXIT_FAILURE otherwise.
+ */
+int main(void) {
+    unsigned long lo, hi, m, d;         /* Loop indices */
+    unsigned long block;                /* Odd integers in the blocks so far */
+    unsigned long cases = 0, failures = 0;  /* Results */
+
+    for (lo = 0; lo <= TEST_SMALL; lo++)
+        for (hi = lo ? lo - 1 : 0; hi <= TEST_SMALL; hi++, cases++)
+            failures += check(lo, hi);
+
+    /* The first blocks end at odd integers 2 FIRST_BLOCK_BITS (2^m - 1) */
+    for (m = 1, block = FIRST_BLOCK_BITS; block <= 4 * BLOCK_BITS;
+            m++, block += FIRST_BLOCK_BITS << (m - 1))
+        for (d = 0; d < 4; d++, cases++)
+            failures += check(0, 2 * block - 2 + d);
+
+    for (d = 0; d < 4; d++, cases += 3) {
+        failures += check(1000000000 + d % 2,
+                1000000000 + 3 * 2 * BLOCK_BITS + d / 2);
+        failures += check((1UL << 44) + d % 2,
+                (1UL << 44) + 3 * 2 * BLOCK_BITS + d / 2);
+        failures += check(1000000000000000 + d % 2,
+                1000000000000000 + 2 * 2 * BLOCK_BITS + d / 2);
+    }
+
+    failures += check(ULONG_MAX - 2 * BLOCK_BITS - 1001, ULONG_MAX);
+    failures += check(ULONG_MAX - 58, ULONG_MAX - 1);
+    cases += 2;
+
+    printf("next_prime: %lu ranges, %lu failures\n", cases, failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*
+ * FUNCTION:    check
+ * DESCRIPTION: Compares the primes next_prime finds in [lo, hi] with the
+ *              reference, reporting the first difference.
+ * PARAMETERS:  lo, hi (const unsigned long): The range.
+ * RETURNS:     0 if they agree, 1 otherwise.
+ */
+static unsigned long check(const unsigned long lo, const unsigned long hi) {
+    struct segsieve *s = new_segsieve(lo, hi);  /* The sieve tested */
+    unsigned char *prime = reference(lo, hi);   /* The expected primes */
+    unsigned long p = 0;                        /* A prime found */
+    unsigned long i;                            /* Offset from lo */
+    int status = 0;                             /* Result of next_prime */
+
+    if (!s || (lo <= hi && !prime)) {
+        perror("segment_test");
+        exit(EXIT_FAILURE);
+    }
+
+    for (i = 0; lo <= hi && i <= hi - lo; i++) {
+        if (!prime[i])
+            continue;
+        if ((status = next_prime(s, &p)) != 1 || p != lo + i) {
+            fprintf(stderr, "[%lu, %lu]: expected %lu, got %lu (status %d)\n",
+                    lo, hi, lo + i, p, status);
+            break;
+        }
+    }
+    if ((lo > hi || i > hi - lo) && (status = next_prime(s, &p)) != 0)
+        fprintf(stderr, "[%lu, %lu]: expected no more primes, got %lu "
+                "(status %d)\n", lo, hi, p, status);
+
+    delete_segsieve(&s);
+    free(prime);
+    return (lo <= hi && i <= hi - lo) || status != 0;
+}
+
+/*
+ * FUNCTION:    reference
+ * DESCRIPTION: Finds the primes in [lo, hi] all at once: by crossing off the
+ *              multiples of the primes up to sqrt(hi) in one array, or, if
+ *              there are too many of those, by testing each integer.
+ * ERRORS:      If memory allocation fails (or lo > hi), returns NULL.
+ * PARAMETERS:  lo, hi (const unsigned long): The range.
+ * RETURNS:     An array of hi - lo + 1 flags, 1 for lo + i prime.
+ */
+static unsigned char * reference(const unsigned long lo,
+        const unsigned long hi) {
+    unsigned char *prime;           /* Return value */
+    unsigned long *small;           /* Sieving or trial division primes */
+    unsigned long nsmall;           /* The number of such primes */
+    unsigned long i, m;             /* Loop indices */
+    int plain = isqrt(hi) <= TEST_PLAIN;    /* 1 for the plain sieve */
+
+    if (lo > hi || !(prime = malloc(hi - lo + 1)))
+        return NULL;
+    if (!(small = small_primes(plain ? isqrt(hi) : TEST_DIV, &nsmall))) {
+        free(prime);
+        return NULL;
+    }
+
+    if (plain) {
+        memset(prime, 1, hi - lo + 1);
+        for (m = lo; m < 2 && m <= hi; m++)
+            prime[m - lo] = 0;
+        for (i = 0; i < nsmall; i++) {
+            m = small[i] * small[i];
+            if (m < lo)
+                m = lo + (small[i] - lo % small[i]) % small[i];
+            for (; m <= hi; m += small[i])
+                prime[m - lo] = 0;
+        }
+    } else {
+        for (i = 0; i <= hi - lo; i++)
+            prime[i] = (unsigned char) is_prime(lo + i, small, nsmall);
+    }
+
+    free(small);
+    return prime;
+}
+
+/*
+ * FUNCTION:    is_prime
+ * DESCRIPTION: Tests an integer for primality by trial division by small
+ *              primes, and then with the Miller-Rabin test to the first 12
+ *              prime bases, which is exact below 3.3 * 10^24.
+ * PARAMETERS:  n (const unsigned long): The integer, above the last small
+ *              prime squared.
+ *              small (const unsigned long *): The small primes, from 2.
+ *              nsmall (const unsigned long): The number of small primes, at
+ *              least 12.
+ * RETURNS:     1 if n is prime, 0 otherwise.
+ */
+static int is_prime(const unsigned long n, const unsigned long *small,
+        const unsigned long nsmall) {
+    unsigned long d = n - 1;    /* n - 1 = d 2^r, d odd */
+    unsigned long x;            /* A power of a base */
+    unsigned long i, j, r;      /* Loop indices */
+
+    for (i = 0; i < nsmall; i++)
+        if (n % small[i] == 0)
+            return 0;
+
+    for (r = 0; d % 2 == 0; r++)
+        d /= 2;
+    for (i = 0; i < 12; i++) {
+        x = powmod(small[i], d, n);
+        /* b^d = 1, or b^(d 2^j) = n - 1 for some j < r, if n is prime */
+        for (j = 0; j + 1 < r && x != 1 && x != n - 1; j++)
+            x = (unsigned long) ((uint128) x * x % n);
+        if (x != n - 1 && (x != 1 || j > 0))
+            return 0;
+    }
+    return 1;
+}
+
+/*
+ * FUNCTION:    powmod
+ * DESCRIPTION: Raises an integer to a power modulo m by repeated squaring.
+ * PARAMETERS:  b (unsigned long): The base.
+ *              e (unsigned long): The exponent.
+ *              m (const unsigned long): The modulus, above 1.
+ * RETURNS:     b^e mod m.
+ */
+static unsigned long powmod(unsigned long b, unsigned long e,
+        const unsigned long m) {
+    unsigned long x = 1;    /* Return value */
+
+    for (b %= m; e; e /= 2) {
+        if (e % 2)
+            x = (unsigned long) ((uint128) x * b % m);
+        b = (unsigned long) ((uint128) b * b % m);
+    }
+    return x;
+}
+
+#endif /* TEST */
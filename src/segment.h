@@ -0,0 +1,19 @@
+/*
+ * FILE:        segment.h
+ * DESCRIPTION: Interface for segmented sieves, which find the primes in a range
+ *              [lo, hi] one cache-sized block at a time. Any range of unsigned
+ *              longs can be sieved, including windows just below ULONG_MAX,
+ *              using memory proportional to the block size and to the number
+ *              of sieving primes up to sqrt(hi), not to hi - lo. The sieving
+ *              primes are only found as the blocks need them, so a sieve up to
+ *              ULONG_MAX can serve as an unbounded stream of primes.
+ */
+
+#ifndef SEGMENT_H
+#define SEGMENT_H
+
+struct segsieve * new_segsieve(const unsigned long, const unsigned long);
+void delete_segsieve(struct segsieve **);
+int next_prime(struct segsieve *, unsigned long *);
+
+#endif
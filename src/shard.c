@@ -0,0 +1,215 @@
+/*
+ * FILE:        shard.c
+ * DESCRIPTION: Implementation of sharded sieving. Shard i of n covers the
+ *              slice [floor((max + 1) i / n), floor((max + 1) (i + 1) / n) - 1]
+ *              and is sieved with a segmented sieve, so shards can run as
+ *              separate processes on separate machines. Each one writes a
+ *              one-line record, and merging the records of all the shards
+ *              gives exactly the record of a single shard 0 of 1.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "segment.h"
+#include "shard.h"
+#include "uint128.h"
+#include "debug.h"
+
+/* Layout of a record */
+#define RECORD_FMT "shard %lu/%lu %lu %lu count=%lu first=%lu last=%lu \
+twins=%lu maxgap=%lu@%lu sum=%lu hash=%016lx\n"
+#define RECORD_FIELDS 12
+
+/* Static ("private") function prototypes */
+static unsigned long hash(unsigned long);
+static void add(struct shard *, const struct shard *);
+static int compare(const void *, const void *);
+
+/*
+ * FUNCTION:    run_shard
+ * DESCRIPTION: Sieves one shard of [0, max] and fills in its record.
+ * ERRORS:      If memory allocation fails, returns -1.
+ * PARAMETERS:  shard (struct shard *): The record to fill in.
+ *              max (const unsigned long): The end of the whole range.
+ *              index (const unsigned long): Which shard, less than nshards.
+ *              nshards (const unsigned long): The number of shards, at most
+ *              max + 1.
+ * RETURNS:     0 on success, -1 on failure.
+ */
+int run_shard(struct shard *shard, const unsigned long max,
+        const unsigned long index, const unsigned long nshards) {
+    struct segsieve *sieve;     /* The sieve over the slice */
+    unsigned long p;            /* A prime in the slice */
+    int status;                 /* Result of looking for the next prime */
+
+    shard->index = index;
+    shard->nshards = nshards;
+    shard->lo = (unsigned long) (((uint128) max + 1) * index / nshards);
+    shard->hi = (unsigned long) (((uint128) max + 1) * (index + 1) / nshards
+            - 1);
+    shard->count = shard->first = shard->last = shard->twins = 0;
+    shard->maxgap = shard->maxgap_start = shard->sum = shard->hash = 0;
+
+    sieve = new_segsieve(shard->lo, shard->hi);
+    if (!sieve)
+        return -1;
+
+    while ((status = next_prime(sieve, &p)) > 0) {
+        if (shard->count++ == 0) {
+            shard->first = p;
+        } else {
+            if (p - shard->last == 2)
+                shard->twins++;
+            if (p - shard->last > shard->maxgap) {
+                shard->maxgap = p - shard->last;
+                shard->maxgap_start = shard->last;
+            }
+        }
+        shard->last = p;
+        shard->sum += p;
+        shard->hash ^= hash(p);
+    }
+
+    DEBUG_MSG("Shard %lu/%lu: [%lu, %lu] has %lu primes",
+            index, nshards, shard->lo, shard->hi, shard->count);
+
+    delete_segsieve(&sieve);
+    return status;
+}
+
+/*
+ * FUNCTION:    merge_shards
+ * DESCRIPTION: Combines the records of all the shards of one run into the
+ *              record of a single run, as shard 0 of 1.
+ * ERRORS:      If there are no records, or they are not exactly the shards
+ *              0/N, ..., N-1/N of one run over [0, max] (each once, with the
+ *              slices that run_shard gives them), returns -1.
+ * PARAMETERS:  shards (struct shard *): The records, in any order. They are
+ *              sorted by slice.
+ *              n (const unsigned long): The number of records.
+ *              merged (struct shard *): Set to the combined record.
+ * RETURNS:     0 on success, -1 on failure.
+ */
+int merge_shards(struct shard *shards, const unsigned long n,
+        struct shard *merged) {
+    uint128 size;   /* The size of [0, max] */
+    unsigned long i;
+
+    if (!n)
+        return -1;
+
+    qsort(shards, n, sizeof(struct shard), &compare);
+
+    /* A partial set of shards would merge into a record that looks like a
+     * complete run, so every shard must be there, and only once */
+    size = (uint128) shards[n - 1].hi + 1;
+    for (i = 0; i < n; i++)
+        if (shards[i].nshards != n || shards[i].index != i
+                || shards[i].lo != (unsigned long) (size * i / n)
+                || shards[i].hi != (unsigned long) (size * (i + 1) / n - 1))
+            return -1;
+
+    *merged = shards[0];
+    merged->index = 0;
+    merged->nshards = 1;
+    for (i = 1; i < n; i++)
+        add(merged, &shards[i]);
+
+    return 0;
+}
+
+/*
+ * FUNCTION:    print_shard
+ * DESCRIPTION: Write a record as one line of text.
+ * PARAMETERS:  shard (const struct shard *): The record.
+ *              stream (FILE *): The stream to write to.
+ * RETURNS:     Nothing.
+ */
+void print_shard(const struct shard *shard, FILE *stream) {
+    fprintf(stream, RECORD_FMT, shard->index, shard->nshards, shard->lo,
+            shard->hi, shard->count, shard->first, shard->last, shard->twins,
+            shard->maxgap, shard->maxgap_start, shard->sum, shard->hash);
+}
+
+/*
+ * FUNCTION:    read_shard
+ * DESCRIPTION: Read a record written by print_shard.
+ * PARAMETERS:  shard (struct shard *): Set to the record read.
+ *              stream (FILE *): The stream to read from.
+ * RETURNS:     1 if a record was read, 0 at the end of the stream, or -1 if
+ *              the next line is not a record.
+ */
+int read_shard(struct shard *shard, FILE *stream) {
+    char line[BUFSIZ];  /* The line holding the record */
+
+    if (!fgets(line, BUFSIZ, stream))
+        return 0;
+    if (sscanf(line, RECORD_FMT, &shard->index, &shard->nshards, &shard->lo,
+                &shard->hi, &shard->count, &shard->first, &shard->last,
+                &shard->twins, &shard->maxgap, &shard->maxgap_start,
+                &shard->sum, &shard->hash) != RECORD_FIELDS)
+        return -1;
+    return 1;
+}
+
+/*
+ * FUNCTION:    add
+ * DESCRIPTION: Extend a record with the record of the slice right after it.
+ * PARAMETERS:  acc (struct shard *): The record to extend.
+ *              next (const struct shard *): The record of the next slice.
+ * RETURNS:     Nothing.
+ */
+static void add(struct shard *acc, const struct shard *next) {
+    acc->hi = next->hi;
+    if (next->count) {
+        if (acc->count) {
+            /* The gap across the boundary */
+            if (next->first - acc->last == 2)
+                acc->twins++;
+            if (next->first - acc->last > acc->maxgap) {
+                acc->maxgap = next->first - acc->last;
+                acc->maxgap_start = acc->last;
+            }
+        } else {
+            acc->first = next->first;
+        }
+        if (next->maxgap > acc->maxgap) {
+            acc->maxgap = next->maxgap;
+            acc->maxgap_start = next->maxgap_start;
+        }
+        acc->last = next->last;
+    }
+    acc->count += next->count;
+    acc->twins += next->twins;
+    acc->sum += next->sum;
+    acc->hash ^= next->hash;
+}
+
+/*
+ * FUNCTION:    compare
+ * DESCRIPTION: Order records by the start of their slices, for qsort.
+ * PARAMETERS:  a, b (const void *): Pointers to the records.
+ * RETURNS:     A negative, zero, or positive number as a's slice starts
+ *              before, with, or after b's.
+ */
+static int compare(const void *a, const void *b) {
+    const struct shard *x = a, *y = b;
+    return (x->lo > y->lo) - (x->lo < y->lo);
+}
+
+/*
+ * FUNCTION:    hash
+ * DESCRIPTION: Mixes the bits of a prime (the SplitMix64 finalizer), so the
+ *              exclusive or of the hashes catches a missing or extra prime.
+ * PARAMETERS:  x (unsigned long): The prime.
+ * RETURNS:     The hash.
+ */
+static unsigned long hash(unsigned long x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9UL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebUL;
+    x ^= x >> 31;
+    return x;
+}
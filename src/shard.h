@@ -0,0 +1,48 @@
+/*
+ * FILE:        shard.h
+ * DESCRIPTION: Interface for splitting a sieve over [0, max] into independent
+ *              shards, and for merging the partial results of the shards into
+ *              the result of a single run.
+ */
+
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <stdio.h>
+
+/*
+ * STRUCT:      shard
+ * DESCRIPTION: The partial result of sieving one slice [lo, hi]. Everything
+ *              but the slice can be combined across adjacent slices, and the
+ *              first and last primes let the gaps and twin primes that
+ *              straddle a boundary be counted.
+ * FIELDS:      index, nshards (unsigned long): This is slice index of nshards.
+ *              lo, hi (unsigned long): The slice (inclusive).
+ *              count (unsigned long): The number of primes in the slice.
+ *              first, last (unsigned long): The first and last primes in the
+ *              slice, or 0 if there are none.
+ *              twins (unsigned long): The number of twin primes (p, p + 2)
+ *              with both in the slice.
+ *              maxgap, maxgap_start (unsigned long): The largest gap between
+ *              consecutive primes in the slice, and the prime starting it.
+ *              sum (unsigned long): The sum of the primes, modulo 2^64.
+ *              hash (unsigned long): The exclusive or of a hash of each prime.
+ */
+struct shard {
+    unsigned long index, nshards;
+    unsigned long lo, hi;
+    unsigned long count;
+    unsigned long first, last;
+    unsigned long twins;
+    unsigned long maxgap, maxgap_start;
+    unsigned long sum;
+    unsigned long hash;
+};
+
+int run_shard(struct shard *, const unsigned long, const unsigned long,
+        const unsigned long);
+int merge_shards(struct shard *, const unsigned long, struct shard *);
+void print_shard(const struct shard *, FILE *);
+int read_shard(struct shard *, FILE *);
+
+#endif
@@ -2,13 +2,16 @@
  * FILE:        sieve.c
  * AUTHOR:      Artem Mavrin
  * DESCRIPTION: Implementation of the sieve of Eratosthenes with wheel
- *              factorization. This creates one of two object files: if the
+ *              factorization. This creates one of three object files: if the
  *              macro COUNT_PRIMES is defined, it creates an object file
  *              containing the function sieve_count, which returns the number of
- *              primes up to a given number. If the macro COUNT_PRIMES is not
- *              defined, it creates an object file containing the function
- *              sieve_list, which prints the primes up to a given number to
- *              stdout. Exactly one of these two macros must be defined.
+ *              primes up to a given number. If the macro GAP_STATS is defined,
+ *              it creates an object file containing the function sieve_gaps,
+ *              which prints statistics on the gaps between the primes up to a
+ *              given number to stdout. If neither macro is defined, it creates
+ *              an object file containing the function sieve_list, which prints
+ *              the primes up to a given number to stdout. At most one of these
+ *              two macros may be defined.
  */
 
 #include <stdlib.h>
@@ -17,25 +20,36 @@
 #include "bitarray.h"
 #include "wheel.h"
 #include "sieve.h"
+#if defined(GAP_STATS)
+#include "gaps.h"
+#elif !defined(COUNT_PRIMES)
+#include "print.h"
+#endif
 
 #define ERR_BIT_ALLOCATE    "sieve: bit array"
 #define ERR_WHEEL_ALLOCATE  "sieve: wheel"
+#define ERR_GAPS_ALLOCATE   "sieve: gap statistics"
 
 static const unsigned long base_primes[] = {2, 3, 5, 7, 11, 13};
 static const unsigned long num_base_primes = 6;
 
-#ifndef COUNT_PRIMES
-/* Function to print an unsigned long to stdout */
-static void printul(unsigned long);
+/* What to do with each prime found */
+#if defined(COUNT_PRIMES)
+#define FOUND_PRIME(p) (count++)
+#elif defined(GAP_STATS)
+#define FOUND_PRIME(p) add_prime(stats, (p))
+#else
+#define FOUND_PRIME(p) printul(p)
 #endif
 
 /*
- * FUNCTIONS:   sieve_count/sieve_list
+ * FUNCTIONS:   sieve_count/sieve_list/sieve_gaps
  * DESCRIPTION: Sieve of Eratosthenes algorithm implementation using wheel
  *              factorization. All the prime numbers less than or equal to a
  *              specified nonnegative integer `max' are found and either
- *              (sieve_list) printed to stdout, or (sieve_count) the number of
- *              such primes is returned.
+ *              (sieve_list) printed to stdout, (sieve_count) the number of
+ *              such primes is returned, or (sieve_gaps) a summary of the gaps
+ *              between consecutive primes is printed to stdout.
  *              First, the prime 2 is sieved if max >= 2. Then, a bit array is
  *              created, with one bit for every odd integer between 0 and max.
  *              The bit represents whether the odd integer is prime (1) or
@@ -44,29 +58,36 @@ static void printul(unsigned long);
  *              the remaining odd primes less than or equal to sqrt(max) are
  *              sieved, and their multiples are marked as composite in the bit
  *              array. Finally, the remaining primes between sqrt(max) and max
- *              are sieved.
+ *              are found by walking the surviving bits directly.
+ *              All the loops work on bit indices and compare against
+ *              max / prime rather than prime * prime, so nothing overflows
+ *              even when max is close to ULONG_MAX.
  * PARAMETERS:  max (const unsigned long): The upper bound for the sieve.
  * RETURNS:     sieve_count: The number of primes less than or equal to max.
- *              sieve_list: Nothing.
+ *              sieve_list, sieve_gaps: Nothing.
  */
-#ifdef COUNT_PRIMES
+#if defined(COUNT_PRIMES)
 unsigned long sieve_count(const unsigned long max)
+#elif defined(GAP_STATS)
+void sieve_gaps(const unsigned long max)
 #else
 void sieve_list(const unsigned long max)
 #endif
 {
     struct bitarray *is_prime = NULL;   /* Bit array representing primality */
     struct wheel *wheel = NULL;         /* The wheel used in the sieve */
-#ifdef COUNT_PRIMES
+#if defined(COUNT_PRIMES)
     unsigned long count = 0;            /* The number of primes */
+#elif defined(GAP_STATS)
+    struct gapstats *stats = NULL;      /* Statistics on the prime gaps */
 #endif
     unsigned long prime;                /* A prime candidate */
-    unsigned long comp;                 /* A necessarily composite number */
     unsigned long index;                /* Track position in loops */
+    const unsigned long nbits = max / 2 + (max & 1);    /* Odd ints <= max */
 
     /* Create the sieving array. To save space we only store the primality of
      * odd integers, starting with 1 in position 0, 3 in position 1, etc. */
-    is_prime = new_bitarray((max + 1) / 2);
+    is_prime = new_bitarray(nbits);
     if (!is_prime) {
         perror(ERR_BIT_ALLOCATE);
         goto failure;
@@ -81,16 +102,21 @@ void sieve_list(const unsigned long max)
         goto failure;
     }
 
+#ifdef GAP_STATS
+    /* Create the gap statistics */
+    stats = new_gapstats();
+    if (!stats) {
+        perror(ERR_GAPS_ALLOCATE);
+        goto failure;
+    }
+#endif
+
     /* Easy case #1: no primes less than 2 */
     if (max < 2)
         goto end;
 
     /* Now max is guaranteed to be at least 2 */
-#ifdef COUNT_PRIMES
-    count++;
-#else
-    printul(2UL);
-#endif
+    FOUND_PRIME(2UL);
 
     /* Easy case #2: only the even prime */
     if (max == 2)
@@ -103,48 +129,38 @@ void sieve_list(const unsigned long max)
         prime = base_primes[index];
         if (prime > max)
             break;
-#ifdef COUNT_PRIMES
-        count++;
-#else
-        printul(prime);
-#endif
-        /* Cross off multiples of the current prime */
-        for (comp = prime * prime; comp <= max; comp += 2 * prime)
-            clear_bit(is_prime, comp / 2);
+        FOUND_PRIME(prime);
+        /* Cross off odd multiples of the current prime (odd multiples are
+         * prime bits apart) */
+        clear_stride(is_prime, prime * prime / 2, prime, nbits);
     }
 
     /* Sieve the remaining primes <= sqrt(max) */
-    for (prime = nextp(wheel); prime * prime <= max; prime = nextp(wheel)) {
+    for (prime = nextp(wheel); prime <= max / prime; prime = nextp(wheel)) {
         if (get_bit(is_prime, prime / 2)) {
-#ifdef COUNT_PRIMES
-            count++;
-#else
-            printul(prime);
-#endif
-            /* Cross off multiples of the current prime */
-            for (comp = prime * prime; comp <= max; comp += 2 * prime)
-                clear_bit(is_prime, comp / 2);
+            FOUND_PRIME(prime);
+            /* Cross off odd multiples of the current prime */
+            clear_stride(is_prime, prime * prime / 2, prime, nbits);
         }
     }
 
-    /* Sieve the remaining primes > sqrt(max) */
-    while(prime <= max) {
-        if (get_bit(is_prime, prime / 2)) {
-#ifdef COUNT_PRIMES
-            count++;
-#else
-            printul(prime);
-#endif
-        }
-        prime = nextp(wheel);
-    }
+    /* Sieve the remaining primes > sqrt(max). Every surviving bit from here
+     * on is a prime, so skip straight to it. Unlike the wheel, the bit
+     * indices can't overflow. */
+    for (index = next_set_bit(is_prime, prime / 2, nbits); index < nbits;
+            index = next_set_bit(is_prime, index + 1, nbits))
+        FOUND_PRIME(2 * index + 1);
 
 end:
     /* Clean up and return */
     delete_bitarray(&is_prime);
     delete_wheel(&wheel);
-#ifdef COUNT_PRIMES
+#if defined(COUNT_PRIMES)
     return count;
+#elif defined(GAP_STATS)
+    print_gapstats(stats, stdout);
+    delete_gapstats(&stats);
+    return;
 #else
     return;
 #endif
@@ -152,30 +168,8 @@ end:
 failure:
     delete_bitarray(&is_prime);
     delete_wheel(&wheel);
+#ifdef GAP_STATS
+    delete_gapstats(&stats);
+#endif
     exit(EXIT_FAILURE);
 }
-
-#ifndef COUNT_PRIMES
-#define BASE 10
-#define TOCHAR(d) ((char) ('0' + (d)))
-/*
- * FUNCTION:    printul
- * DESCRIPTION: Prints an unsigned long to stdout (in decimal). This function
- *              automatically appends a newline at the end.
- * PARAMETERS:  n (unsigned long): The number to be printed.
- * RETURNS:     Nothing.
- */
-static void printul(unsigned long n) {
-    char digits[BUFSIZ];
-    char *digit = digits;
-    *digit++ = '\0';
-    while (n) {
-        *digit++ = TOCHAR(n % BASE);
-        n /= BASE;
-    }
-    while (*--digit) {
-        putchar(*digit);
-    }
-    putchar('\n');
-}
-#endif
@@ -2,13 +2,16 @@
  * FILE:        sieve.h
  * AUTHOR:      Artem Mavrin
  * DESCRIPTION: Sieve of Eratosthenes function prototypes: one function to count
- *              the number of primes up to a given number, and one function to
- *              list the primes up to a given number.
+ *              the number of primes up to a given number, one function to list
+ *              the primes up to a given number, and one function to summarize
+ *              the gaps between the primes up to a given number.
  */
 
 #ifndef SIEVE_H
+#define SIEVE_H
 
 unsigned long sieve_count(const unsigned long);
 void sieve_list(const unsigned long);
+void sieve_gaps(const unsigned long);
 
 #endif
@@ -0,0 +1,418 @@
+/*
+ * FILE:        spf.c
+ * DESCRIPTION: Implementation of smallest-prime-factor tables. Only the
+ *              numbers coprime to 30 (the spokes of the 2-3-5 wheel) are
+ *              stored, 8 out of every 30 integers. For each stored composite
+ *              number the table holds a 16-bit index into a table of the
+ *              primes up to the square root of the limit; primes hold 0.
+ *              The whole table lives in one buffer laid out exactly like the
+ *              file it is saved to (a header, the prime table, and the 16-bit
+ *              entries, all in native byte order), so a saved table can be
+ *              memory-mapped and used in place.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "primes.h"
+#include "spf.h"
+#include "debug.h"
+
+#define SPF_MAGIC   "SIEVESPF"  /* Identifies a table file */
+#define SPF_VERSION 1           /* Version of the table file layout */
+
+/* Number of entries sieved at a time (64 KiB of entries) */
+#define BLOCK_ENTRIES 32768UL
+
+/* Largest square root of a limit with fewer than UINT16_MAX sieving primes:
+ * the UINT16_MAX-th prime is 821641 */
+#define MAX_ROOT 821640UL
+
+/* Circumference and number of spokes of the 2-3-5 wheel */
+#define CIRCUMFERENCE   30
+#define NUM_SPOKES      8
+
+/* The spokes of the 2-3-5 wheel */
+static const unsigned long spokes[NUM_SPOKES] = {1, 7, 11, 13, 17, 19, 23, 29};
+
+/* Position of each residue mod 30 among the spokes (-1 if not a spoke) */
+static const int spoke_index[CIRCUMFERENCE] = {
+    -1,  0, -1, -1, -1, -1, -1,  1, -1, -1,
+    -1,  2, -1,  3, -1, -1, -1,  4, -1,  5,
+    -1, -1, -1,  6, -1, -1, -1, -1, -1,  7
+};
+
+/* Distance from each residue mod 30 to the next spoke strictly above it */
+static const unsigned char spoke_step[CIRCUMFERENCE] = {
+     1,  6,  5,  4,  3,  2,  1,  4,  3,  2,
+     1,  2,  1,  4,  3,  2,  1,  2,  1,  4,
+     3,  2,  1,  6,  5,  4,  3,  2,  1,  2
+};
+
+/*
+ * STRUCT:      spf_header
+ * DESCRIPTION: The header at the start of a table buffer (and file).
+ * FIELDS:      magic (char [8]): SPF_MAGIC, without a terminating null.
+ *              version (uint64_t): SPF_VERSION.
+ *              limit (uint64_t): Every number up to limit can be factored.
+ *              nprimes (uint64_t): The number of primes in the prime table.
+ *              nentries (uint64_t): The number of 16-bit entries.
+ */
+struct spf_header {
+    char magic[8];
+    uint64_t version;
+    uint64_t limit;
+    uint64_t nprimes;
+    uint64_t nentries;
+};
+
+/*
+ * STRUCT:      spf_table
+ * DESCRIPTION: A smallest-prime-factor table, either built in memory or
+ *              mapped from a file.
+ * FIELDS:      header (struct spf_header *): Start of the buffer.
+ *              primes (const uint32_t *): The primes up to sqrt(limit).
+ *              entries (const uint16_t *): One entry per spoke up to limit:
+ *              0 for 1 and the primes, otherwise 1 + the index of the
+ *              smallest prime factor in the prime table.
+ *              size (size_t): The size of the buffer in bytes.
+ *              mapped (int): 1 if the buffer is memory-mapped, 0 if it is
+ *              allocated with malloc.
+ */
+struct spf_table {
+    struct spf_header *header;
+    const uint32_t *primes;
+    const uint16_t *entries;
+    size_t size;
+    int mapped;
+};
+
+/* Index of the entry of a number coprime to 30 */
+#define ENTRY(n) \
+    ((n) / CIRCUMFERENCE * NUM_SPOKES \
+     + (unsigned long) spoke_index[(n) % CIRCUMFERENCE])
+
+/* Number represented by an entry */
+#define NUMBER(e) ((e) / NUM_SPOKES * CIRCUMFERENCE + spokes[(e) % NUM_SPOKES])
+
+/* Static ("private") function prototypes */
+static unsigned long num_entries(const unsigned long);
+static size_t buffer_size(const unsigned long, const unsigned long);
+static void set_pointers(struct spf_table *);
+
+/*
+ * FUNCTION:    new_spf_table
+ * DESCRIPTION: Creates the smallest-prime-factor table for all the numbers up
+ *              to a specified limit with a segmented sieve: the entries are
+ *              processed in cache-sized blocks, and each sieving prime p
+ *              marks the multiples p * k (k >= p, k coprime to 30) in the
+ *              block that have no smaller prime factor. The table is
+ *              dynamically allocated and must be deallocated with the
+ *              delete_spf_table function.
+ * ERRORS:      If memory allocation fails, returns NULL. If there are too many
+ *              sieving primes to index with 16 bits (the limit is at least
+ *              821641^2, about 6.75e11), sets errno to ERANGE and returns
+ *              NULL.
+ * PARAMETERS:  limit (const unsigned long): The largest number to cover.
+ * RETURNS:     A pointer to the new table.
+ */
+struct spf_table * new_spf_table(const unsigned long limit) {
+    struct spf_table *table = NULL; /* The table being created */
+    unsigned long *primes = NULL;   /* The sieving primes */
+    unsigned long nprimes;          /* The number of sieving primes */
+    unsigned long nentries;         /* The number of entries */
+    uint32_t *prime_table;          /* The prime table in the buffer */
+    uint16_t *entries;              /* The entries in the buffer */
+    unsigned long first, last;      /* Entries in the current block */
+    unsigned long lo, hi;           /* Numbers in the current block */
+    unsigned long i;                /* Index of a sieving prime */
+    unsigned long p, k, m;          /* Sieving prime, cofactor, multiple */
+
+    /* Check before sieving, which would take long for a huge limit */
+    if (isqrt(limit) > MAX_ROOT) {
+        errno = ERANGE;
+        goto failure;
+    }
+    primes = small_primes(isqrt(limit), &nprimes);
+    if (!primes)
+        goto failure;
+
+    nentries = num_entries(limit);
+
+    table = malloc(sizeof(struct spf_table));
+    if (!table)
+        goto failure;
+    table->mapped = 0;
+    table->size = buffer_size(nprimes, nentries);
+    table->header = calloc(1, table->size);
+    if (!table->header)
+        goto failure;
+
+    /* Fill in the header and the prime table */
+    memcpy(table->header->magic, SPF_MAGIC, sizeof(table->header->magic));
+    table->header->version = SPF_VERSION;
+    table->header->limit = limit;
+    table->header->nprimes = nprimes;
+    table->header->nentries = nentries;
+    set_pointers(table);
+    prime_table = (uint32_t *) table->primes;
+    entries = (uint16_t *) table->entries;
+    for (i = 0; i < nprimes; i++)
+        prime_table[i] = (uint32_t) primes[i];
+
+    /* Sieve one block of entries at a time. The primes 2, 3, 5 (the first
+     * three) never divide a spoke. */
+    for (first = 0; first < nentries; first += BLOCK_ENTRIES) {
+        last = first + BLOCK_ENTRIES < nentries ? first + BLOCK_ENTRIES
+                                                : nentries;
+        lo = NUMBER(first);
+        hi = NUMBER(last - 1);
+        for (i = 3; i < nprimes && primes[i] <= hi / primes[i]; i++) {
+            p = primes[i];
+
+            /* Smallest spoke k >= p with p * k >= lo */
+            k = (lo + p - 1) / p;
+            if (k < p)
+                k = p;
+            if (spoke_index[k % CIRCUMFERENCE] < 0)
+                k += spoke_step[k % CIRCUMFERENCE];
+
+            /* Mark the multiples without a smaller prime factor */
+            for (m = p * k; m <= hi; m = p * k) {
+                if (!entries[ENTRY(m)])
+                    entries[ENTRY(m)] = (uint16_t) (i + 1);
+                k += spoke_step[k % CIRCUMFERENCE];
+            }
+        }
+    }
+
+    free(primes);
+
+    DEBUG_MSG("New SPF table at %p (limit: %lu, primes: %lu, entries: %lu)",
+            (void *) table, limit, nprimes, nentries);
+
+    return table;
+
+failure:
+    free(primes);
+    delete_spf_table(&table);
+    return NULL;
+}
+
+/*
+ * FUNCTION:    map_spf_table
+ * DESCRIPTION: Memory-maps a table previously written by save_spf_table. The
+ *              mapping is read-only and shared, so any number of processes
+ *              can map the same file while the operating system keeps one
+ *              copy of it in memory. The table must be deallocated with the
+ *              delete_spf_table function.
+ * ERRORS:      If the file cannot be opened or mapped, or memory allocation
+ *              fails, returns NULL with errno set. If the file is not a valid
+ *              table (including one whose number of entries doesn't match its
+ *              limit, so that lookups up to the limit would run past the
+ *              mapping), sets errno to EINVAL and returns NULL.
+ * PARAMETERS:  path (const char *): The path of the table file.
+ * RETURNS:     A pointer to the mapped table.
+ */
+struct spf_table * map_spf_table(const char *path) {
+    struct spf_table *table = NULL; /* The table being mapped */
+    struct stat st;                 /* Information about the file */
+    struct spf_header *header;      /* The header of the mapped file */
+    void *map;                      /* The mapping */
+    int fd;                         /* File descriptor of the file */
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return NULL;
+    }
+    if ((size_t) st.st_size < sizeof(struct spf_header)) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+    map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return NULL;
+
+    /* Check that this is a complete table file. With the number of entries
+     * checked against the limit first, the buffer size can't overflow. */
+    header = map;
+    if (memcmp(header->magic, SPF_MAGIC, sizeof(header->magic))
+            || header->version != SPF_VERSION
+            || header->nprimes >= UINT16_MAX
+            || header->nentries != num_entries(header->limit)
+            || buffer_size(header->nprimes, header->nentries)
+                != (size_t) st.st_size) {
+        munmap(map, (size_t) st.st_size);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    table = malloc(sizeof(struct spf_table));
+    if (!table) {
+        munmap(map, (size_t) st.st_size);
+        return NULL;
+    }
+    table->header = header;
+    table->size = (size_t) st.st_size;
+    table->mapped = 1;
+    set_pointers(table);
+
+    DEBUG_MSG("Mapped SPF table at %p (limit: %lu)",
+            (void *) table, (unsigned long) header->limit);
+
+    return table;
+}
+
+/*
+ * FUNCTION:    delete_spf_table
+ * DESCRIPTION: Deallocates (or unmaps) all memory associated with a table.
+ * PARAMETERS:  tpp (struct spf_table **): A pointer to a pointer to the table
+ *              being deleted.
+ * RETURNS:     Nothing.
+ */
+void delete_spf_table(struct spf_table **tpp) {
+    if (tpp && *tpp) {
+        DEBUG_MSG("Deleting SPF table at %p ...", (void *) *tpp);
+
+        if ((*tpp)->mapped)
+            munmap((void *) (*tpp)->header, (*tpp)->size);
+        else
+            free((*tpp)->header);
+        free(*tpp);
+        *tpp = NULL;
+    }
+}
+
+/*
+ * FUNCTION:    save_spf_table
+ * DESCRIPTION: Writes a table to a file that can later be memory-mapped with
+ *              the map_spf_table function.
+ * ERRORS:      If the file cannot be written, returns -1 with errno set.
+ * PARAMETERS:  table (struct spf_table *): The table to save.
+ *              path (const char *): The path of the file to write.
+ * RETURNS:     0 on success, -1 on failure.
+ */
+int save_spf_table(struct spf_table *table, const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (!file)
+        return -1;
+    if (fwrite(table->header, 1, table->size, file) != table->size) {
+        fclose(file);
+        return -1;
+    }
+    return fclose(file) ? -1 : 0;
+}
+
+/*
+ * FUNCTION:    spf_limit
+ * DESCRIPTION: Get the largest number a table can factor.
+ * PARAMETERS:  table (struct spf_table *): The table.
+ * RETURNS:     The limit of the table.
+ */
+unsigned long spf_limit(struct spf_table *table) {
+    return (unsigned long) table->header->limit;
+}
+
+/*
+ * FUNCTION:    spf_factor
+ * DESCRIPTION: Factors a number into primes using a table. The factors 2, 3,
+ *              and 5 are divided out first; after that the number is coprime
+ *              to 30, and each remaining prime factor costs one table lookup.
+ * ERRORS:      If n is 0 or larger than the table's limit, or the table is
+ *              corrupt (an entry that is not a prime factor of its number),
+ *              returns -1.
+ * PARAMETERS:  table (struct spf_table *): The table to use.
+ *              n (unsigned long): The number to factor.
+ *              factors (unsigned long *): Set to the prime factors of n in
+ *              nondecreasing order, with multiplicity. There must be room for
+ *              SPF_MAX_FACTORS factors.
+ * RETURNS:     The number of prime factors of n, or -1 on error.
+ */
+int spf_factor(struct spf_table *table, unsigned long n,
+        unsigned long *factors) {
+    static const unsigned long wheel_primes[] = {2, 3, 5};
+    int count = 0;          /* Number of factors found */
+    unsigned long p;        /* Current prime factor */
+    unsigned long i;        /* Index into wheel_primes */
+    uint16_t entry;         /* Table entry of n */
+
+    if (n == 0 || n > table->header->limit)
+        return -1;
+
+    for (i = 0; i < sizeof(wheel_primes) / sizeof(*wheel_primes); i++) {
+        while (n % wheel_primes[i] == 0) {
+            factors[count++] = wheel_primes[i];
+            n /= wheel_primes[i];
+        }
+    }
+
+    while (n > 1) {
+        entry = table->entries[ENTRY(n)];
+        if (entry > table->header->nprimes)
+            return -1;
+        p = entry ? table->primes[entry - 1] : n;
+        if (p < 2 || n % p)
+            return -1;
+        factors[count++] = p;
+        n /= p;
+    }
+
+    return count;
+}
+
+/*
+ * FUNCTION:    num_entries
+ * DESCRIPTION: Computes the number of entries of a table: one for each spoke
+ *              of the wheel up to its limit.
+ * PARAMETERS:  limit (const unsigned long): The limit of the table.
+ * RETURNS:     The number of entries.
+ */
+static unsigned long num_entries(const unsigned long limit) {
+    unsigned long nentries = limit / CIRCUMFERENCE * NUM_SPOKES;
+    unsigned long i;
+
+    for (i = 0; i < NUM_SPOKES; i++)
+        if (spokes[i] <= limit % CIRCUMFERENCE)
+            nentries++;
+    return nentries;
+}
+
+/*
+ * FUNCTION:    buffer_size
+ * DESCRIPTION: Computes the size of a table buffer.
+ * PARAMETERS:  nprimes (const unsigned long): The number of primes.
+ *              nentries (const unsigned long): The number of entries.
+ * RETURNS:     The size of the buffer in bytes.
+ */
+static size_t buffer_size(const unsigned long nprimes,
+        const unsigned long nentries) {
+    return sizeof(struct spf_header) + nprimes * sizeof(uint32_t)
+        + nentries * sizeof(uint16_t);
+}
+
+/*
+ * FUNCTION:    set_pointers
+ * DESCRIPTION: Point the prime table and the entries of a table into its
+ *              buffer, right after the header.
+ * PARAMETERS:  table (struct spf_table *): The table. Its header must be set.
+ * RETURNS:     Nothing.
+ */
+static void set_pointers(struct spf_table *table) {
+    table->primes = (const uint32_t *) (table->header + 1);
+    table->entries = (const uint16_t *) (table->primes
+            + table->header->nprimes);
+}
@@ -0,0 +1,22 @@
+/*
+ * FILE:        spf.h
+ * DESCRIPTION: Interface for smallest-prime-factor tables, which allow any
+ *              number up to the table's limit to be factored with one table
+ *              lookup per prime factor. Tables can be saved to a file and
+ *              memory-mapped back, so several processes can share one table.
+ */
+
+#ifndef SPF_H
+#define SPF_H
+
+/* Enough room for the prime factors of any unsigned long */
+#define SPF_MAX_FACTORS 64
+
+struct spf_table * new_spf_table(const unsigned long);
+struct spf_table * map_spf_table(const char *);
+void delete_spf_table(struct spf_table **);
+int save_spf_table(struct spf_table *, const char *);
+unsigned long spf_limit(struct spf_table *);
+int spf_factor(struct spf_table *, unsigned long, unsigned long *);
+
+#endif
@@ -0,0 +1,14 @@
+/*
+ * FILE:        uint128.h
+ * DESCRIPTION: Defines a 128-bit unsigned integer type for accumulators that
+ *              would overflow an unsigned long. This relies on the unsigned
+ *              __int128 extension of GCC and Clang; __extension__ keeps
+ *              -pedantic from rejecting it.
+ */
+
+#ifndef UINT128_H
+#define UINT128_H
+
+__extension__ typedef unsigned __int128 uint128;
+
+#endif